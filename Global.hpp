@@ -43,8 +43,10 @@
 #define ORGANIZATION_NAME "FolcoSoft"
 #define APPLICATION_NAME  "TBI"
 
-// Command line option
+// Command line options
 #define OPTION_FORCE_INDEX_CHECK "--check-index"
+#define OPTION_TRACE             "--trace="
+#define OPTION_MEMORY_REPORT     "--memory-report"
 
 // Data filename
 
@@ -0,0 +1,172 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "DateIndex.hpp"
+#include "MemoryReport.hpp"
+#include <algorithm>
+#include <QStringList>
+
+//  build
+//
+// Index a whole TB list at once. Sorting once is much faster than inserting the TB one by one
+//
+void DateIndex::build(const QList<TechnicalBulletin*>& bulletins)
+{
+    this->Entries.clear();
+    this->Entries.reserve(bulletins.count());
+    for (int i = 0; i < bulletins.count(); i++) {
+        if ((bulletins.at(i) != nullptr) && bulletins.at(i)->releaseDate().isValid()) {
+            this->Entries << Entry{bulletins.at(i)->releaseDate(), i};
+        }
+    }
+    std::sort(this->Entries.begin(), this->Entries.end());
+}
+
+void DateIndex::addTB(qint32 id, const TechnicalBulletin* tb)
+{
+    if (tb->releaseDate().isValid()) {
+        Entry NewEntry{tb->releaseDate(), id};
+        this->Entries.insert(std::lower_bound(this->Entries.begin(), this->Entries.end(), NewEntry), NewEntry);
+    }
+}
+
+void DateIndex::removeTB(qint32 id, const TechnicalBulletin* tb)
+{
+    Entry OldEntry{tb->releaseDate(), id};
+    auto  Position = std::lower_bound(this->Entries.begin(), this->Entries.end(), OldEntry);
+    if ((Position != this->Entries.end()) && (Position->Id == id) && (Position->Date == OldEntry.Date)) {
+        this->Entries.erase(Position);
+    }
+}
+
+void DateIndex::clear()
+{
+    this->Entries.clear();
+}
+
+//  bounds
+//
+// Find the slice of entries released between two dates, both included.
+// An invalid date means that the range is open on this side
+//
+void DateIndex::bounds(QDate from, QDate to, QList<Entry>::const_iterator* first, QList<Entry>::const_iterator* last) const
+{
+    *first = this->Entries.constBegin();
+    *last  = this->Entries.constEnd();
+
+    if (from.isValid()) {
+        *first = std::lower_bound(*first, *last, from, [](const Entry& entry, const QDate& date) { return entry.Date < date; });
+    }
+    if (to.isValid()) {
+        *last = std::upper_bound(*first, *last, to, [](const QDate& date, const Entry& entry) { return date < entry.Date; });
+    }
+}
+
+//  range
+//
+// Return the ids of the TB released between two dates
+//
+QList<qint32> DateIndex::range(QDate from, QDate to) const
+{
+    QList<Entry>::const_iterator First, Last;
+    bounds(from, to, &First, &Last);
+
+    QList<qint32> Ids;
+    Ids.reserve(Last - First);
+    for (auto It = First; It != Last; ++It) {
+        Ids << It->Id;
+    }
+    return Ids;
+}
+
+//  count
+//
+// Return the number of TB released between two dates, without building the id list
+//
+int DateIndex::count(QDate from, QDate to) const
+{
+    QList<Entry>::const_iterator First, Last;
+    bounds(from, to, &First, &Last);
+    return static_cast<int>(Last - First);
+}
+
+// Parse a bound of a date range: yyyy, yyyy-MM or yyyy-MM-dd.
+// The lower bound is the first day of the period, the upper bound the last one
+static bool parseBound(const QString& text, bool upper, QDate* date)
+{
+    // Empty bound: open range
+    if (text.isEmpty()) {
+        *date = QDate();
+        return true;
+    }
+
+    QStringList Parts = text.split('-');
+    bool        Ok[3] = {true, true, true};
+    int         Year  = Parts.at(0).toInt(&Ok[0]);
+    int         Month = Parts.count() > 1 ? Parts.at(1).toInt(&Ok[1]) : (upper ? 12 : 1);
+    int         Day   = 1;
+
+    if ((Parts.count() > 3) || !Ok[0] || !Ok[1] || (Month < 1) || (Month > 12)) {
+        return false;
+    }
+
+    if (Parts.count() == 3) {
+        Day = Parts.at(2).toInt(&Ok[2]);
+    }
+    else if (upper) {
+        Day = QDate(Year, Month, 1).daysInMonth();
+    }
+
+    *date = QDate(Year, Month, Day);
+    return Ok[2] && date->isValid();
+}
+
+//  parseRange
+//
+// Parse a date range, without the query prefix:
+// - 2022          the whole year
+// - 2022-01       the whole month
+// - 2022-01-15    a single day
+// - 2022..2023-06 from the beginning of the first period to the end of the second one
+// - 2022.. / ..2023-06 open ranges
+//
+bool DateIndex::parseRange(const QString& text, QDate* from, QDate* to)
+{
+    int Separator = text.indexOf(DATE_RANGE_SEPARATOR);
+
+    // Single period
+    if (Separator == -1) {
+        return !text.isEmpty() && parseBound(text, false, from) && parseBound(text, true, to);
+    }
+
+    // Range. At least one bound must be given
+    QString Lower = text.left(Separator);
+    QString Upper = text.mid(Separator + QString(DATE_RANGE_SEPARATOR).length());
+    if (Lower.isEmpty() && Upper.isEmpty()) {
+        return false;
+    }
+    return parseBound(Lower, false, from) && parseBound(Upper, true, to);
+}
+
+qint64 DateIndex::memoryUsage() const
+{
+    return MemoryReport::arrayBytes(this->Entries.capacity(), sizeof(Entry));
+}
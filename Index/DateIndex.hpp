@@ -0,0 +1,66 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef DATEINDEX_HPP
+#define DATEINDEX_HPP
+
+#include "TechnicalBulletin.hpp"
+#include <QDate>
+#include <QList>
+#include <QString>
+
+//  DateIndex
+//
+// TB ids sorted by release date.
+// A date range is resolved with two binary searches, giving a contiguous slice of ids.
+// TB without a valid release date are not indexed
+//
+class DateIndex
+{
+  public:
+    void build(const QList<TechnicalBulletin*>& bulletins);
+    void addTB(qint32 id, const TechnicalBulletin* tb);
+    void removeTB(qint32 id, const TechnicalBulletin* tb);
+    void clear();
+
+    QList<qint32> range(QDate from, QDate to) const;
+    int           count(QDate from, QDate to) const;
+    qint64        memoryUsage() const;
+
+    static bool parseRange(const QString& text, QDate* from, QDate* to);
+
+  private:
+    struct Entry
+    {
+        QDate  Date;
+        qint32 Id;
+        bool   operator<(const Entry& other) const { return (this->Date < other.Date) || ((this->Date == other.Date) && (this->Id < other.Id)); }
+    };
+
+    QList<Entry> Entries;
+
+    void bounds(QDate from, QDate to, QList<Entry>::const_iterator* first, QList<Entry>::const_iterator* last) const;
+};
+
+// Separator of the bounds of a date range in a search query, eg. date:2022-01..2023-06
+#define DATE_RANGE_SEPARATOR ".."
+
+#endif // DATEINDEX_HPP
@@ -0,0 +1,170 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "IndexService.hpp"
+#include <QBitArray>
+#include <QEventLoop>
+
+IndexService::IndexService(const QString& fileName, bool forceIndexCheck, QObject* parent)
+    : QObject(parent)
+    , Index(new ThreadIndex(forceIndexCheck, fileName))
+    , Complete(false)
+    , Opened(false)
+    , Count(0)
+{
+    // The opening signals are emitted by the loading thread. They are queued after the loaded data,
+    // so the index is complete when openingComplete() is received
+    connect(this->Index, &ThreadIndex::indexOpenedSuccessfully, this, [this](qint32 count) {
+        this->Opened = true;
+        this->Count  = count;
+    });
+    connect(this->Index, &ThreadIndex::noIndexFound, this, [this]() { this->Opened = true; });
+    connect(this->Index, &ThreadIndex::failedToOpenIndex, this, [this]() { this->Failure = QString("Impossible to open %1").arg(this->Index->fileName()); });
+    connect(this->Index, &ThreadIndex::invalidIndexIdentifier, this, [this](QString magic) { this->Failure = QString("Invalid index identifier: %1").arg(magic); });
+    connect(this->Index, &ThreadIndex::indexTooRecent, this, [this](qint32 version) { this->Failure = QString("Index version %1 is not supported").arg(version); });
+    connect(this->Index, &ThreadIndex::indexReadingFailed, this, [this](int count) {
+        this->Failure = QString("Reading failure, %1 Technical Bulletins could be read").arg(count);
+    });
+    connect(this->Index, &ThreadIndex::openingComplete, this, [this]() { openingComplete(); });
+    connect(this->Index, &ThreadIndex::saveComplete, this, [this](int result) { emit saved(result); });
+}
+
+IndexService::~IndexService()
+{
+    // The loading thread runs an event loop once the index is read
+    this->Index->quit();
+    this->Index->wait();
+    delete this->Index;
+}
+
+//  open
+//
+// Start reading the index file. opened() or openingFailed() is emitted when it is done.
+// A missing file is not a failure: the index is empty, and will be created when saved
+//
+void IndexService::open()
+{
+    this->Index->start();
+}
+
+void IndexService::openingComplete()
+{
+    this->Complete = true;
+    if (this->Opened) {
+        emit opened(this->Count);
+    }
+    else {
+        emit openingFailed(this->Failure);
+    }
+}
+
+//  waitForOpened
+//
+// Open the index if needed, and wait until the opening is complete. Return true on success
+//
+bool IndexService::waitForOpened()
+{
+    if (!this->Complete) {
+        QEventLoop Loop;
+        connect(this, &IndexService::opened, &Loop, &QEventLoop::quit);
+        connect(this, &IndexService::openingFailed, &Loop, &QEventLoop::quit);
+        if (!this->Index->isRunning()) {
+            open();
+        }
+        Loop.exec();
+    }
+    return this->Opened;
+}
+
+//  count
+//
+// Return the number of TB in the index
+//
+int IndexService::count() const
+{
+    QList<TechnicalBulletin*> List = this->Index->tbList();
+    return static_cast<int>(List.count() - List.count(nullptr));
+}
+
+//  search
+//
+// Return the ids of the TB matching a query, in increasing order
+//
+QList<qint32> IndexService::search(const QString& query, quint32 fields, bool wholeWords) const
+{
+    QBitArray     Result = this->Index->search(query, fields, wholeWords);
+    QList<qint32> Ids;
+    for (qint32 Id = 0; Id < Result.size(); Id++) {
+        if (Result.testBit(Id)) {
+            Ids << Id;
+        }
+    }
+    return Ids;
+}
+
+qint32 IndexService::addTB(TechnicalBulletin* tb)
+{
+    qint32 Id = this->Index->addTB(tb);
+    emit modified(this->Index->generation());
+    return Id;
+}
+
+void IndexService::addTBs(const QList<TechnicalBulletin*>& bulletins)
+{
+    this->Index->addTBs(bulletins);
+    emit modified(this->Index->generation());
+}
+
+void IndexService::updateTB(qint32 id, const TechnicalBulletin& data)
+{
+    this->Index->updateTB(id, data);
+    emit modified(this->Index->generation());
+}
+
+void IndexService::removeTB(qint32 id)
+{
+    this->Index->removeTB(id);
+    emit modified(this->Index->generation());
+}
+
+//  save
+//
+// Save the index. The result (see ThreadIndex.hpp) is returned, and emitted with saved()
+//
+int IndexService::save(bool backup)
+{
+    int Result = SAVE_FAILED;
+    connect(this, &IndexService::saved, this, [&Result](int result) { Result = result; }, Qt::SingleShotConnection);
+    this->Index->save(backup);
+    return Result;
+}
+
+//  snapshot
+//
+// Return a read-only copy of the current index. It is rebuilt only when the generation changed, and shares the TB with the index
+//
+QSharedPointer<const IndexSnapshot> IndexService::snapshot()
+{
+    if (this->Snapshot.isNull() || (this->Snapshot->generation() != this->Index->generation())) {
+        this->Snapshot = QSharedPointer<const IndexSnapshot>(this->Index->snapshot());
+    }
+    return this->Snapshot;
+}
@@ -0,0 +1,92 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef INDEXSERVICE_HPP
+#define INDEXSERVICE_HPP
+
+#include "IndexSnapshot.hpp"
+#include "TechnicalBulletin.hpp"
+#include "ThreadIndex.hpp"
+#include <QList>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+//  IndexService
+//
+// Entry point of the core library for the programs without GUI (command line tools, benchmarks, server).
+// It owns a ThreadIndex, and reduces its opening signals to a single success or failure.
+// It must be used from a thread running an event loop, because the loaded data are installed through queued signals:
+// either the application event loop, or waitForOpened() which runs a local one
+//
+class IndexService: public QObject
+{
+    Q_OBJECT
+
+  public:
+    IndexService(const QString& fileName, bool forceIndexCheck = false, QObject* parent = nullptr);
+    ~IndexService() override;
+
+    // Opening
+    void open();
+    bool waitForOpened();
+    bool isOpened() const { return this->Opened; }
+
+    // Read access
+    int                count() const;
+    TechnicalBulletin* tb(qint32 id) const { return this->Index->tb(id); }
+    qint32             findTB(const QString& number) const { return this->Index->findTB(number); }
+    QList<qint32>      search(const QString& query, quint32 fields = ALL_FIELDS_MASK, bool wholeWords = false) const;
+    QStringList        suggestions(const QString& prefix, quint32 fields, int count) const { return this->Index->suggestions(prefix, fields, count); }
+
+    // Modifications
+    qint32 addTB(TechnicalBulletin* tb);
+    void   addTBs(const QList<TechnicalBulletin*>& bulletins);
+    void   updateTB(qint32 id, const TechnicalBulletin& data);
+    void   removeTB(qint32 id);
+    int    save(bool backup = BACKUP_ON_SAVE);
+
+    // Read-only copy of the index, for the reader threads. A new one is created only if the index was modified
+    QSharedPointer<const IndexSnapshot> snapshot();
+
+    // Direct access to the engine, for the clients needing more
+    ThreadIndex* index() const { return this->Index; }
+
+  signals:
+    void opened(int count);
+    void openingFailed(QString reason);
+    void modified(quint64 generation);
+    void saved(int result);
+
+  private:
+    ThreadIndex* Index;
+    bool         Complete; // Opening complete, successfully or not
+    bool         Opened;
+    int          Count;
+    QString      Failure;
+
+    QSharedPointer<const IndexSnapshot> Snapshot;
+
+    void openingComplete();
+};
+
+#endif // INDEXSERVICE_HPP
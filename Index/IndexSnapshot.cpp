@@ -0,0 +1,72 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "IndexSnapshot.hpp"
+#include "ThreadIndex.hpp"
+
+IndexSnapshot::IndexSnapshot(const QList<QSharedPointer<TechnicalBulletin>>& store,
+                             const QHash<QString, qint32>&                   numbers,
+                             const TermDictionary&                           dictionary,
+                             const DateIndex&                                dates,
+                             quint64                                         generation,
+                             bool                                            indexed)
+    : Store(store)
+    , Count(0)
+    , Numbers(numbers)
+    , Dictionary(dictionary)
+    , Dates(dates)
+    , Generation(generation)
+    , Indexed(indexed)
+    , Engine(Bulletins, Dictionary, Dates, Generation, Indexed, false)
+{
+    // The search engine reads raw pointers, like in the live index
+    this->Bulletins.reserve(this->Store.count());
+    for (int i = 0; i < this->Store.count(); i++) {
+        this->Bulletins << this->Store.at(i).data();
+        if (!this->Store.at(i).isNull()) {
+            this->Count++;
+        }
+    }
+}
+
+const TechnicalBulletin* IndexSnapshot::tb(qint32 id) const
+{
+    return (id >= 0) && (id < this->Bulletins.count()) ? this->Bulletins.at(id) : nullptr;
+}
+
+//  findTB
+//
+// Return the id of a TB, or INVALID_TB_ID if the number is unknown
+//
+qint32 IndexSnapshot::findTB(const QString& number) const
+{
+    QString Number = ThreadIndex::normalizeNumber(number);
+    return Number.isEmpty() ? INVALID_TB_ID : this->Numbers.value(Number, INVALID_TB_ID);
+}
+
+//  search
+//
+// Return the TB matching a query, as a bit array indexed by TB id
+//
+QBitArray IndexSnapshot::search(const QString& query, quint32 fields, bool wholeWords) const
+{
+    return this->Engine.search(query, fields, wholeWords);
+}
@@ -0,0 +1,73 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef INDEXSNAPSHOT_HPP
+#define INDEXSNAPSHOT_HPP
+
+#include "DateIndex.hpp"
+#include "SearchEngine.hpp"
+#include "TechnicalBulletin.hpp"
+#include "TermDictionary.hpp"
+#include <QBitArray>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+//  IndexSnapshot
+//
+// Read-only copy of the index at a given generation, created by ThreadIndex::snapshot().
+// It is never modified once created, so any number of threads can read it at the same time without lock.
+// The containers are implicitly shared with the live index, which detaches its own copy when it is modified.
+// The TB are shared with the live index, which replaces a TB instead of modifying it
+//
+class IndexSnapshot
+{
+  public:
+    IndexSnapshot(const QList<QSharedPointer<TechnicalBulletin>>& store,
+                  const QHash<QString, qint32>&                   numbers,
+                  const TermDictionary&                           dictionary,
+                  const DateIndex&                                dates,
+                  quint64                                         generation,
+                  bool                                            indexed);
+
+    quint64                  generation() const { return this->Generation; }
+    int                      size() const { return static_cast<int>(this->Store.count()); }
+    int                      count() const { return this->Count; }
+    const TechnicalBulletin* tb(qint32 id) const;
+    qint32                   findTB(const QString& number) const;
+    QBitArray                search(const QString& query, quint32 fields, bool wholeWords) const;
+
+  private:
+    Q_DISABLE_COPY(IndexSnapshot)
+
+    QList<QSharedPointer<TechnicalBulletin>> Store; // Null for removed TB
+    QList<TechnicalBulletin*>                Bulletins;
+    int                                      Count;
+    QHash<QString, qint32>                   Numbers;
+    TermDictionary                           Dictionary;
+    DateIndex                                Dates;
+    quint64                                  Generation;
+    bool                                     Indexed;
+    SearchEngine                             Engine; // Without cache, see SearchEngine
+};
+
+#endif // INDEXSNAPSHOT_HPP
@@ -0,0 +1,240 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "MailImporter.hpp"
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentMap>
+#include <functional>
+
+//  import
+//
+// Read the mails of the files and directories (not recursively), then decode and parse them in parallel.
+// The progress is reported once per mail. Mails which are not TB are ignored.
+// All the TB are returned at once, as a single result. Nothing is returned if the import is cancelled
+//
+void MailImporter::import(QPromise<QList<TechnicalBulletin*>>& promise, const QStringList& paths)
+{
+    QList<QByteArray> Mails;
+    for (int i = 0; i < paths.count(); i++) {
+        QFileInfo Info(paths.at(i));
+        if (Info.isDir()) {
+            QDir        Directory(paths.at(i));
+            QStringList Files = Directory.entryList(QStringList {MAIL_FILE_EXTENSIONS}, QDir::Files, QDir::Name);
+            for (int j = 0; j < Files.count(); j++) {
+                readFile(Directory.filePath(Files.at(j)), Mails);
+            }
+        }
+        else {
+            readFile(paths.at(i), Mails);
+        }
+
+        if (promise.isCanceled()) {
+            return;
+        }
+    }
+
+    // The workers share the progress counter. The promise ignores the values reported out of order
+    promise.setProgressRange(0, Mails.count());
+    QAtomicInt                                                Progress;
+    std::function<TechnicalBulletin*(const QByteArray& mail)> Parse = [&promise, &Progress](const QByteArray& mail) {
+        TechnicalBulletin* TB = nullptr;
+        if (!promise.isCanceled()) {
+            QByteArray Mail = decodeMail(mail);
+            if (Mail.contains(TB_MAIL_LABEL)) {
+                TB = new TechnicalBulletin(Mail);
+            }
+        }
+        promise.setProgressValue(Progress.fetchAndAddRelaxed(1) + 1);
+        return TB;
+    };
+    QList<TechnicalBulletin*> Parsed = QtConcurrent::blockingMapped(Mails, Parse);
+    Parsed.removeAll(nullptr);
+
+    if (promise.isCanceled()) {
+        qDeleteAll(Parsed);
+        return;
+    }
+    promise.addResult(Parsed);
+}
+
+//  readFile
+//
+// Read the mails of a file. A mbox begins with a separator line, else the file contains a single mail
+//
+void MailImporter::readFile(const QString& path, QList<QByteArray>& mails)
+{
+    QFile File(path);
+    if (!File.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QByteArray Data = File.readAll();
+    if (Data.startsWith(MBOX_SEPARATOR)) {
+        splitMbox(Data, mails);
+    }
+    else {
+        mails << Data;
+    }
+}
+
+//  splitMbox
+//
+// Split the content of a mbox. Each mail begins with a line starting with "From ", which is not part of the mail
+//
+void MailImporter::splitMbox(const QByteArray& data, QList<QByteArray>& mails)
+{
+    qsizetype Start = 0;
+    while (Start < data.size()) {
+        qsizetype Begin = data.indexOf('\n', Start);
+        if (Begin == -1) {
+            break;
+        }
+
+        qsizetype End = data.indexOf("\n" MBOX_SEPARATOR, Begin);
+        if (End == -1) {
+            End = data.size();
+        }
+        mails << data.mid(Begin + 1, End - Begin - 1);
+        Start = End + 1;
+    }
+}
+
+//  decodeMail
+//
+// Return the text of a mail, which can be parsed by TechnicalBulletin(QByteArray).
+// Raw mails (.eml) have headers, their body can be encoded (quoted-printable or base64) or split into several parts.
+// Text without any MIME header (copied from the mail client) is returned as is
+//
+QByteArray MailImporter::decodeMail(const QByteArray& mail)
+{
+    QByteArray Mail(mail);
+    Mail.replace("\r\n", "\n");
+
+    qsizetype HeadersEnd = Mail.indexOf("\n\n");
+    if (HeadersEnd == -1) {
+        return Mail;
+    }
+
+    QByteArray Headers  = Mail.left(HeadersEnd + 1);
+    QByteArray Type     = headerValue(Headers, "Content-Type");
+    QByteArray Encoding = headerValue(Headers, "Content-Transfer-Encoding").toLower();
+    if (Type.isEmpty() && Encoding.isEmpty()) {
+        return Mail;
+    }
+    QByteArray Body = Mail.mid(HeadersEnd + 2);
+
+    // Multipart: use the first part containing a TB
+    if (Type.toLower().startsWith("multipart/")) {
+        qsizetype BoundaryStart = Type.toLower().indexOf("boundary=");
+        if (BoundaryStart == -1) {
+            return Body;
+        }
+        QByteArray Boundary    = Type.mid(BoundaryStart + 9);
+        qsizetype  BoundaryEnd = Boundary.indexOf(';');
+        if (BoundaryEnd != -1) {
+            Boundary.truncate(BoundaryEnd);
+        }
+        Boundary = "--" + Boundary.trimmed().replace('"', "");
+
+        qsizetype PartStart = Body.indexOf(Boundary);
+        while (PartStart != -1) {
+            PartStart         = Body.indexOf('\n', PartStart);
+            qsizetype PartEnd = PartStart == -1 ? -1 : Body.indexOf("\n" + Boundary, PartStart);
+            if (PartEnd == -1) {
+                break;
+            }
+
+            QByteArray Part = decodeMail(Body.mid(PartStart + 1, PartEnd - PartStart - 1));
+            if (Part.contains(TB_MAIL_LABEL)) {
+                return Part;
+            }
+            PartStart = PartEnd + 1;
+        }
+        return Body;
+    }
+
+    // Single part
+    if (Encoding == "quoted-printable") {
+        return decodeQuotedPrintable(Body);
+    }
+    if (Encoding == "base64") {
+        return QByteArray::fromBase64(Body).replace("\r\n", "\n");
+    }
+    return Body;
+}
+
+//  headerValue
+//
+// Return the value of a header, without case sensitivity. A value can be folded over several lines
+//
+QByteArray MailImporter::headerValue(const QByteArray& headers, const QByteArray& name)
+{
+    QByteArray Lines = '\n' + headers;
+    qsizetype  Start = Lines.toLower().indexOf('\n' + name.toLower() + ':');
+    if (Start == -1) {
+        return QByteArray();
+    }
+    Start += name.size() + 2;
+
+    // The continuation lines begin with a space or a tab
+    qsizetype End = Lines.indexOf('\n', Start);
+    while ((End != -1) && (End + 1 < Lines.size()) && ((Lines.at(End + 1) == ' ') || (Lines.at(End + 1) == '\t'))) {
+        End = Lines.indexOf('\n', End + 1);
+    }
+    if (End == -1) {
+        End = Lines.size();
+    }
+    return Lines.mid(Start, End - Start).simplified();
+}
+
+//  decodeQuotedPrintable
+//
+// Decode a quoted-printable body: "=XX" is an hexadecimal byte, "=" at the end of a line is a soft line break
+//
+QByteArray MailImporter::decodeQuotedPrintable(const QByteArray& data)
+{
+    QByteArray Decoded;
+    Decoded.reserve(data.size());
+
+    for (qsizetype i = 0; i < data.size(); i++) {
+        char Char = data.at(i);
+        if (Char == '=') {
+            if ((i + 1 < data.size()) && (data.at(i + 1) == '\n')) {
+                i++;
+                continue;
+            }
+
+            bool Ok   = false;
+            int  Byte = data.mid(i + 1, 2).toInt(&Ok, 16);
+            if (Ok && (i + 2 < data.size())) {
+                Decoded += static_cast<char>(Byte);
+                i += 2;
+                continue;
+            }
+        }
+        Decoded += Char;
+    }
+
+    return Decoded;
+}
@@ -0,0 +1,62 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef MAILIMPORTER_HPP
+#define MAILIMPORTER_HPP
+
+#include "TechnicalBulletin.hpp"
+#include <QByteArray>
+#include <QList>
+#include <QPromise>
+#include <QString>
+#include <QStringList>
+
+//  MailImporter
+//
+// Bulk import of TB mails saved on disk: .eml files (one mail per file), mbox files (several mails),
+// or directories containing such files.
+// The files are read and split into mails, then the mails are decoded and parsed in parallel.
+// The importer runs in a worker thread (see QtConcurrent::run) and reports its progress through its promise.
+// The TB are not checked against the index, this is done by the caller when it receives them
+//
+class MailImporter
+{
+  public:
+    static void       import(QPromise<QList<TechnicalBulletin*>>& promise, const QStringList& paths);
+    static QByteArray decodeMail(const QByteArray& mail);
+
+  private:
+    static void       readFile(const QString& path, QList<QByteArray>& mails);
+    static void       splitMbox(const QByteArray& data, QList<QByteArray>& mails);
+    static QByteArray headerValue(const QByteArray& headers, const QByteArray& name);
+    static QByteArray decodeQuotedPrintable(const QByteArray& data);
+};
+
+// Extensions of the files handled by the importer
+#define MAIL_FILE_EXTENSIONS "*.eml", "*.mbox", "*.mbx", "*.txt"
+
+// Line separating the mails in a mbox file
+#define MBOX_SEPARATOR "From "
+
+// Label which must be found in a mail to consider it as a TB
+#define TB_MAIL_LABEL "Bulletin No:"
+
+#endif // MAILIMPORTER_HPP
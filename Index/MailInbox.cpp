@@ -0,0 +1,123 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "MailInbox.hpp"
+#include "MailImporter.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+MailInbox::MailInbox()
+    : Watcher(new QFileSystemWatcher(this))
+    , SettleTimer(new QTimer(this))
+{
+    // A directory change is handled when no other change happened during the settle delay
+    this->SettleTimer->setSingleShot(true);
+    this->SettleTimer->setInterval(INBOX_SETTLE_DELAY);
+    connect(this->SettleTimer, &QTimer::timeout, this, [this]() { scan(); });
+    connect(this->Watcher, &QFileSystemWatcher::directoryChanged, this, [this]() { this->SettleTimer->start(); });
+}
+
+//  setDirectory
+//
+// Watch a new directory, then read the mails already present
+//
+void MailInbox::setDirectory(const QString& directory)
+{
+    if (directory == this->Directory) {
+        return;
+    }
+
+    if (!this->Directory.isEmpty()) {
+        this->Watcher->removePath(this->Directory);
+    }
+    this->SettleTimer->stop();
+    this->Seen.clear();
+    this->Directory = directory;
+
+    if (!this->Directory.isEmpty() && this->Watcher->addPath(this->Directory)) {
+        scan();
+    }
+}
+
+//  scan
+//
+// Read the mails of the files added or modified since the previous scan.
+// A file modified during the settle delay may still be written: it is read at the next scan
+//
+void MailInbox::scan()
+{
+    QDir             Inbox(this->Directory);
+    QFileInfoList    Files = Inbox.entryInfoList(QStringList {INBOX_FILE_EXTENSIONS}, QDir::Files, QDir::Time | QDir::Reversed);
+    QDateTime        Now   = QDateTime::currentDateTime();
+    QList<InboxMail> Mails;
+
+    QHash<QString, QDateTime> Seen;
+    for (int i = 0; i < Files.count(); i++) {
+        const QFileInfo& Info     = Files.at(i);
+        QDateTime        Modified = Info.lastModified();
+        if (this->Seen.value(Info.fileName()) == Modified) {
+            Seen.insert(Info.fileName(), Modified);
+            continue;
+        }
+        if (Modified.msecsTo(Now) < INBOX_SETTLE_DELAY) {
+            this->SettleTimer->start();
+            continue;
+        }
+
+        QFile File(Info.filePath());
+        if (!File.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        Seen.insert(Info.fileName(), Modified);
+
+        QByteArray Data = MailImporter::decodeMail(File.readAll());
+        Mails << InboxMail {Info.filePath(), Data, Data.contains(TB_MAIL_LABEL) ? new TechnicalBulletin(Data) : nullptr};
+    }
+
+    // Forget the files which are not in the inbox anymore
+    this->Seen = Seen;
+
+    if (!Mails.isEmpty()) {
+        emit mailsReceived(Mails);
+    }
+}
+
+//  archive
+//
+// Move the files handled to the archive sub-directory, replacing older files with the same name
+//
+void MailInbox::archive(const QStringList& paths)
+{
+    for (int i = 0; i < paths.count(); i++) {
+        QFileInfo Info(paths.at(i));
+        QDir      Inbox = Info.dir();
+        if (!Inbox.mkpath(INBOX_ARCHIVE_DIRECTORY)) {
+            continue;
+        }
+
+        QString Destination = QDir(Inbox.filePath(INBOX_ARCHIVE_DIRECTORY)).filePath(Info.fileName());
+        QFile::remove(Destination);
+        if (QFile::rename(paths.at(i), Destination)) {
+            this->Seen.remove(Info.fileName());
+        }
+    }
+}
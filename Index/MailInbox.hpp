@@ -0,0 +1,88 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef MAILINBOX_HPP
+#define MAILINBOX_HPP
+
+#include "TechnicalBulletin.hpp"
+#include <QByteArray>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+//  InboxMail
+//
+// Mail file found in the inbox. TB is nullptr if the mail is not a TB
+//
+struct InboxMail
+{
+    QString            Path;
+    QByteArray         Data; // Decoded mail
+    TechnicalBulletin* TB;
+};
+Q_DECLARE_METATYPE(QList<InboxMail>)
+
+//  MailInbox
+//
+// Watch a directory where TB mails are saved, and parse the new ones.
+// It lives in its own thread: the watcher wakes it up when the directory changes,
+// so it costs nothing while the inbox is idle. The mails are sent to the GUI thread, which decides
+// which TB can be added to the index. The files handled are then moved to a sub-directory
+//
+class MailInbox: public QObject
+{
+    Q_OBJECT
+
+  public:
+    MailInbox();
+
+    // Must be called in the inbox thread. An empty directory disables the inbox
+    void setDirectory(const QString& directory);
+    void archive(const QStringList& paths);
+
+  signals:
+    void mailsReceived(QList<InboxMail> mails);
+
+  private:
+    QFileSystemWatcher*       Watcher;
+    QTimer*                   SettleTimer;
+    QString                   Directory;
+    QHash<QString, QDateTime> Seen; // Files already read, with their modification time
+
+    void scan();
+};
+
+// Files read in the inbox (one mail per file)
+#define INBOX_FILE_EXTENSIONS "*.eml", "*.txt"
+
+// Sub-directory receiving the files handled
+#define INBOX_ARCHIVE_DIRECTORY "Imported"
+
+// Delay without modification before a file is read, so files being written are not read (ms)
+#define INBOX_SETTLE_DELAY 1000
+
+#endif // MAILINBOX_HPP
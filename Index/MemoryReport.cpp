@@ -0,0 +1,168 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "MemoryReport.hpp"
+#include <QLocale>
+
+MemoryReport::MemoryReport()
+    : TBCount(0)
+    , Fields{}
+{
+}
+
+//  addTB
+//
+// Account the strings of a TB. The release date is stored in the TB object itself
+//
+void MemoryReport::addTB(const TechnicalBulletin* tb)
+{
+    this->TBCount++;
+    addString(FIELD_NUMBER, tb->number());
+    addString(FIELD_TITLE, tb->title());
+    addString(FIELD_CATEGORY, tb->category());
+    addString(FIELD_RK, tb->rk());
+    addString(FIELD_TECH_PUB, tb->techpub());
+    addString(FIELD_REGISTERED_BY, tb->registeredBy());
+    addString(FIELD_REPLACES, tb->replaces());
+    addString(FIELD_REPLACED_BY, tb->replacedBy());
+    addString(FIELD_COMMENT, tb->comment());
+
+    QList<QString> Keywords = tb->keywords();
+    this->Fields[FIELD_KEYWORDS].Bytes += arrayBytes(Keywords.capacity(), sizeof(QString));
+    for (int i = 0; i < Keywords.count(); i++) {
+        addString(FIELD_KEYWORDS, Keywords.at(i));
+    }
+}
+
+void MemoryReport::addString(TB_FIELD field, const QString& text)
+{
+    FieldUsage& Usage = this->Fields[field];
+    qint64      Bytes = stringBytes(text);
+    if (Bytes == 0) {
+        return;
+    }
+
+    Usage.Strings++;
+    if (this->Storages.contains(text.constData())) {
+        Usage.Shared += Bytes;
+        return;
+    }
+
+    this->Storages.insert(text.constData());
+    Usage.Bytes += Bytes;
+    if (this->Values[field].contains(text)) {
+        Usage.Poolable += Bytes;
+    }
+    else {
+        this->Values[field].insert(text);
+    }
+}
+
+//  newStringBytes
+//
+// Return the size of a string not owned by a TB, or 0 if its storage was already counted
+//
+qint64 MemoryReport::newStringBytes(const QString& text)
+{
+    qint64 Bytes = stringBytes(text);
+    if ((Bytes == 0) || this->Storages.contains(text.constData())) {
+        return 0;
+    }
+    this->Storages.insert(text.constData());
+    return Bytes;
+}
+
+void MemoryReport::addSubsystem(const QString& name, qint64 bytes)
+{
+    this->Subsystems << qMakePair(name, bytes);
+}
+
+qint64 MemoryReport::total() const
+{
+    qint64 Total = 0;
+    for (int Field = 0; Field < FIELD_COUNT; Field++) {
+        Total += this->Fields[Field].Bytes;
+    }
+    for (int i = 0; i < this->Subsystems.count(); i++) {
+        Total += this->Subsystems.at(i).second;
+    }
+    return Total;
+}
+
+//  text
+//
+// Return the report as a text table
+//
+QString MemoryReport::text() const
+{
+    QLocale Locale = QLocale::c();
+    auto    size   = [&Locale](qint64 bytes) { return Locale.formattedDataSize(bytes).rightJustified(12); };
+
+    QString Text = QString("Memory used by %1 TB: %2\n").arg(this->TBCount).arg(Locale.formattedDataSize(total()));
+    Text += QString("%1%2%3%4%5\n")
+                .arg("Field", -16)
+                .arg("Size", 12)
+                .arg("Strings", 12)
+                .arg("Shared", 12)
+                .arg("Poolable", 12);
+    qint64 Shared   = 0;
+    qint64 Poolable = 0;
+    for (int Field = 0; Field < FIELD_COUNT; Field++) {
+        const FieldUsage& Usage = this->Fields[Field];
+        if (Field == FIELD_RELEASE_DATE) {
+            continue;
+        }
+        Text += QString("%1%2%3%4%5\n")
+                    .arg(TechnicalBulletin::fieldName(static_cast<TB_FIELD>(Field)), -16)
+                    .arg(size(Usage.Bytes))
+                    .arg(Usage.Strings, 12)
+                    .arg(size(Usage.Shared))
+                    .arg(size(Usage.Poolable));
+        Shared += Usage.Shared;
+        Poolable += Usage.Poolable;
+    }
+    Text += QString("Implicit sharing saves %1, a string pool would save %2 more\n").arg(Locale.formattedDataSize(Shared), Locale.formattedDataSize(Poolable));
+
+    Text += QString("%1%2\n").arg("Subsystem", -28).arg("Size", 12);
+    for (int i = 0; i < this->Subsystems.count(); i++) {
+        Text += QString("%1%2\n").arg(this->Subsystems.at(i).first, -28).arg(size(this->Subsystems.at(i).second));
+    }
+    return Text;
+}
+
+//  stringBytes
+//
+// Return the size of the storage of a string, 0 for the strings without allocated storage
+//
+qint64 MemoryReport::stringBytes(const QString& text)
+{
+    return text.capacity() == 0 ? 0 : arrayBytes(text.capacity() + 1, sizeof(QChar));
+}
+
+qint64 MemoryReport::arrayBytes(qsizetype capacity, qsizetype elementSize)
+{
+    return capacity == 0 ? 0 : MEMORY_ARRAY_HEADER_SIZE + static_cast<qint64>(capacity) * elementSize;
+}
+
+qint64 MemoryReport::hashBytes(qsizetype count, qsizetype buckets, qsizetype nodeSize)
+{
+    return static_cast<qint64>(buckets) * MEMORY_HASH_BUCKET_OVERHEAD + static_cast<qint64>(count) * nodeSize;
+}
@@ -0,0 +1,80 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef MEMORYREPORT_HPP
+#define MEMORYREPORT_HPP
+
+#include "TechnicalBulletin.hpp"
+#include <QArrayData>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QString>
+
+//  MemoryReport
+//
+// Estimate of the memory used by the index, per TB field and per subsystem.
+// The strings are measured with their allocated capacity. A string storage shared by several TB (implicit sharing)
+// is counted once: the bytes saved are reported as "shared". Equal strings stored separately are reported as "poolable",
+// which is what a string pool (interning) would save.
+// The container overheads are estimated from their capacity, allocator overheads are not counted
+//
+class MemoryReport
+{
+  public:
+    MemoryReport();
+
+    void    addTB(const TechnicalBulletin* tb);
+    void    addSubsystem(const QString& name, qint64 bytes);
+    qint64  newStringBytes(const QString& text);
+    qint64  total() const;
+    QString text() const;
+
+    static qint64 stringBytes(const QString& text);
+    static qint64 arrayBytes(qsizetype capacity, qsizetype elementSize);
+    static qint64 hashBytes(qsizetype count, qsizetype buckets, qsizetype nodeSize);
+
+  private:
+    struct FieldUsage
+    {
+        qint64 Bytes;
+        qint64 Strings;
+        qint64 Shared;   // Saved by implicit sharing
+        qint64 Poolable; // Would be saved by a string pool
+    };
+
+    int                           TBCount;
+    FieldUsage                    Fields[FIELD_COUNT];
+    QSet<const void*>             Storages;            // String storages already counted
+    QSet<QString>                 Values[FIELD_COUNT]; // Distinct values of each field
+    QList<QPair<QString, qint64>> Subsystems;
+
+    void addString(TB_FIELD field, const QString& text);
+};
+
+// Size of the header of a Qt array (strings, lists)
+#define MEMORY_ARRAY_HEADER_SIZE static_cast<qint64>(sizeof(QArrayData))
+
+// Estimated overheads of a QMap node (red-black tree node) and of a QHash bucket
+#define MEMORY_MAP_NODE_OVERHEAD    32
+#define MEMORY_HASH_BUCKET_OVERHEAD 1
+
+#endif // MEMORYREPORT_HPP
@@ -0,0 +1,160 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "ParallelScan.hpp"
+#include "TermDictionary.hpp"
+#include "Trace.hpp"
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+ParallelScan::ParallelScan(const QList<TechnicalBulletin*>& bulletins)
+    : Bulletins(bulletins)
+{
+}
+
+//  execute
+//
+// Evaluate a query on every TB. Words which are not qualified by a field name are searched in the given fields
+//
+QBitArray ParallelScan::execute(const Query& query, quint32 fields, bool wholeWords) const
+{
+    TRACE_SCOPE("Parallel scan");
+    int Count = this->Bulletins.count();
+
+    QList<Chunk> Chunks;
+    for (int First = 0; First < Count; First += SCAN_CHUNK_SIZE) {
+        Chunks << Chunk{First, std::min(SCAN_CHUNK_SIZE, Count - First)};
+    }
+
+    std::function<QBitArray(const Chunk&)> Scan = [this, &query, fields, wholeWords](const Chunk& chunk) {
+        return scanChunk(chunk, query, fields, wholeWords);
+    };
+    QList<QBitArray> Results = QtConcurrent::blockingMapped(Chunks, Scan);
+
+    // Merge the chunk results
+    QBitArray Result(Count);
+    for (int i = 0; i < Chunks.count(); i++) {
+        const QBitArray& Matches = Results.at(i);
+        for (int j = 0; j < Matches.size(); j++) {
+            if (Matches.testBit(j)) {
+                Result.setBit(Chunks.at(i).First + j);
+            }
+        }
+    }
+    return Result;
+}
+
+//  scanChunk
+//
+// Evaluate a query on a chunk of TB. Bit i of the result is set if the TB First + i matches
+//
+QBitArray ParallelScan::scanChunk(const Chunk& chunk, const Query& query, quint32 fields, bool wholeWords) const
+{
+    TRACE_SCOPE("Scan chunk");
+    QBitArray Matches(chunk.Count);
+    for (int i = 0; i < chunk.Count; i++) {
+        const TechnicalBulletin* TB = this->Bulletins.at(chunk.First + i);
+        if (TB != nullptr) {
+            TBWords Words;
+            Words.TB = TB;
+            std::fill(std::begin(Words.Split), std::end(Words.Split), false);
+            Matches.setBit(i, match(query, query.root(), Words, fields, wholeWords));
+        }
+    }
+    return Matches;
+}
+
+//  match
+//
+// Evaluate a query node on a TB
+//
+bool ParallelScan::match(const Query& query, int index, TBWords& words, quint32 fields, bool wholeWords) const
+{
+    const QueryNode& Node = query.node(index);
+
+    switch (Node.Type) {
+        case NODE_WORD:
+            return matchWord(Node.Word, words, Node.Fields != 0 ? Node.Fields : fields, wholeWords);
+
+        case NODE_DATE: {
+            QDate Date = words.TB->releaseDate();
+            return Date.isValid() && (!Node.From.isValid() || (Date >= Node.From)) && (!Node.To.isValid() || (Date <= Node.To));
+        }
+
+        case NODE_ALL:
+            return true;
+
+        case NODE_NOT:
+            return !match(query, Node.Children.first(), words, fields, wholeWords);
+
+        case NODE_OR:
+            for (int i = 0; i < Node.Children.count(); i++) {
+                if (match(query, Node.Children.at(i), words, fields, wholeWords)) {
+                    return true;
+                }
+            }
+            return false;
+
+        case NODE_AND:
+            for (int i = 0; i < Node.Children.count(); i++) {
+                if (!match(query, Node.Children.at(i), words, fields, wholeWords)) {
+                    return false;
+                }
+            }
+            return true;
+    }
+
+    return false;
+}
+
+//  matchWord
+//
+// Look for a word in the selected fields of a TB. The words of a field are split only once per TB
+//
+bool ParallelScan::matchWord(const QString& word, TBWords& words, quint32 fields, bool wholeWords) const
+{
+    QString Word = TermDictionary::normalize(word);
+
+    for (int Field = 0; Field < FIELD_COUNT; Field++) {
+        if (!(fields & FIELD_MASK(Field))) {
+            continue;
+        }
+
+        if (!words.Split[Field]) {
+            words.Words[Field] = words.TB->fieldTokens(static_cast<TB_FIELD>(Field));
+            for (int i = 0; i < words.Words[Field].count(); i++) {
+                words.Words[Field][i] = TermDictionary::normalize(words.Words[Field].at(i));
+            }
+            words.Split[Field] = true;
+        }
+
+        const QStringList& Words = words.Words[Field];
+        for (int i = 0; i < Words.count(); i++) {
+            if (wholeWords ? (Words.at(i) == Word) : Words.at(i).contains(Word)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
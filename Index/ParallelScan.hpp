@@ -0,0 +1,71 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef PARALLELSCAN_HPP
+#define PARALLELSCAN_HPP
+
+#include "Query.hpp"
+#include "TechnicalBulletin.hpp"
+#include <QBitArray>
+#include <QList>
+#include <QStringList>
+
+//  ParallelScan
+//
+// Fallback search executor, used while the term dictionary and the date index are not built.
+// It reads the TB themselves: the store is split in chunks small enough to stay in cache,
+// the chunks are evaluated on all the cores, then their results are merged in a single bit array.
+// The matching rules are the same as the ones of the dictionary: a whole word must equal a word of a field,
+// a partial word must be contained in a word of a field, case insensitive
+//
+class ParallelScan
+{
+  public:
+    ParallelScan(const QList<TechnicalBulletin*>& bulletins);
+
+    QBitArray execute(const Query& query, quint32 fields, bool wholeWords) const;
+
+  private:
+    const QList<TechnicalBulletin*>& Bulletins;
+
+    struct Chunk
+    {
+        int First;
+        int Count;
+    };
+
+    // Normalized words of a TB, split lazily field by field
+    struct TBWords
+    {
+        const TechnicalBulletin* TB;
+        QStringList              Words[FIELD_COUNT];
+        bool                     Split[FIELD_COUNT];
+    };
+
+    QBitArray scanChunk(const Chunk& chunk, const Query& query, quint32 fields, bool wholeWords) const;
+    bool      match(const Query& query, int index, TBWords& words, quint32 fields, bool wholeWords) const;
+    bool      matchWord(const QString& word, TBWords& words, quint32 fields, bool wholeWords) const;
+};
+
+// Number of TB evaluated by a task
+#define SCAN_CHUNK_SIZE 256
+
+#endif // PARALLELSCAN_HPP
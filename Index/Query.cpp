@@ -0,0 +1,255 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "Query.hpp"
+#include "DateIndex.hpp"
+#include "TermDictionary.hpp"
+#include <algorithm>
+
+// Operators
+#define OPERATOR_AND "AND"
+#define OPERATOR_OR  "OR"
+#define OPERATOR_NOT "NOT"
+
+//  Query
+//
+// Split the text into tokens, then parse them
+//
+Query::Query(const QString& text)
+    : Position(0)
+    , Root(-1)
+{
+    // Words are separated by spaces. Parentheses are tokens by themselves.
+    // Stray closing parentheses are dropped here, so the parser only has to handle missing ones
+    QString Word;
+    int     Depth = 0;
+    for (int i = 0; i <= text.length(); i++) {
+        QChar Char = i < text.length() ? text.at(i) : QChar(' ');
+        if (Char.isSpace() || (Char == '(') || (Char == ')')) {
+            if (!Word.isEmpty()) {
+                this->Tokens << Word;
+                Word.clear();
+            }
+            if (Char == '(') {
+                this->Tokens << "(";
+                Depth++;
+            }
+            else if ((Char == ')') && (Depth > 0)) {
+                this->Tokens << ")";
+                Depth--;
+            }
+        }
+        else {
+            Word.append(Char);
+        }
+    }
+
+    this->Root = atEnd() ? addNode(NODE_ALL) : parseOr();
+}
+
+int Query::addNode(NODE_TYPE type)
+{
+    QueryNode Node;
+    Node.Type   = type;
+    Node.Fields = 0;
+    Node.Cost   = 0;
+    this->Nodes << Node;
+    return this->Nodes.count() - 1;
+}
+
+int Query::parseOr()
+{
+    QList<int> Children;
+    Children << parseAnd();
+
+    while (!atEnd() && (this->Tokens.at(this->Position) == OPERATOR_OR)) {
+        this->Position++;
+        if (atEnd() || (this->Tokens.at(this->Position) == ")")) {
+            break; // Dangling operator, ignored
+        }
+        Children << parseAnd();
+    }
+
+    if (Children.count() == 1) {
+        return Children.first();
+    }
+    int Index                   = addNode(NODE_OR);
+    this->Nodes[Index].Children = Children;
+    return Index;
+}
+
+int Query::parseAnd()
+{
+    QList<int> Children;
+    Children << parseUnary();
+
+    while (!atEnd() && (this->Tokens.at(this->Position) != ")") && (this->Tokens.at(this->Position) != OPERATOR_OR)) {
+        if (this->Tokens.at(this->Position) == OPERATOR_AND) {
+            this->Position++;
+            if (atEnd() || (this->Tokens.at(this->Position) == ")")) {
+                break; // Dangling operator, ignored
+            }
+        }
+        Children << parseUnary();
+    }
+
+    if (Children.count() == 1) {
+        return Children.first();
+    }
+    int Index                   = addNode(NODE_AND);
+    this->Nodes[Index].Children = Children;
+    return Index;
+}
+
+int Query::parseUnary()
+{
+    QString Token = this->Tokens.at(this->Position);
+
+    // "NOT word", "- word" or "-word"
+    if ((Token == OPERATOR_NOT) || Token.startsWith(QUERY_NOT_PREFIX)) {
+        if ((Token.length() > 1) && (Token != OPERATOR_NOT)) {
+            this->Tokens[this->Position] = Token.mid(1);
+        }
+        else {
+            this->Position++;
+        }
+
+        // Dangling operator: ignored, so a query being typed doesn't hide everything
+        if (atEnd() || (this->Tokens.at(this->Position) == ")")) {
+            return addNode(NODE_ALL);
+        }
+
+        int Child = parseUnary();
+        int Index = addNode(NODE_NOT);
+        this->Nodes[Index].Children << Child;
+        return Index;
+    }
+
+    return parsePrimary();
+}
+
+int Query::parsePrimary()
+{
+    QString Token = this->Tokens.at(this->Position++);
+
+    if (Token == "(") {
+        // Empty parentheses
+        if (atEnd() || (this->Tokens.at(this->Position) == ")")) {
+            this->Position++;
+            return addNode(NODE_ALL);
+        }
+
+        int Index = parseOr();
+        if (!atEnd() && (this->Tokens.at(this->Position) == ")")) {
+            this->Position++;
+        }
+        return Index;
+    }
+
+    return parseWord(Token);
+}
+
+//  parseWord
+//
+// A word may be qualified by a field name. An unknown field name makes the whole token a simple word
+//
+int Query::parseWord(const QString& token)
+{
+    TB_FIELD Field;
+    int      Separator = token.indexOf(QUERY_FIELD_SEPARATOR);
+
+    if ((Separator > 0) && fieldFromName(token.left(Separator), &Field)) {
+        QString Word = token.mid(Separator + 1);
+
+        // Field name being typed, nothing to filter yet
+        if (Word.isEmpty()) {
+            return addNode(NODE_ALL);
+        }
+
+        // Release date range
+        QDate From, To;
+        if ((Field == FIELD_RELEASE_DATE) && DateIndex::parseRange(Word, &From, &To)) {
+            int Index               = addNode(NODE_DATE);
+            this->Nodes[Index].From = From;
+            this->Nodes[Index].To   = To;
+            return Index;
+        }
+
+        int Index                 = addNode(NODE_WORD);
+        this->Nodes[Index].Word   = TermDictionary::normalize(Word);
+        this->Nodes[Index].Fields = FIELD_MASK(Field);
+        return Index;
+    }
+
+    int Index               = addNode(NODE_WORD);
+    this->Nodes[Index].Word = TermDictionary::normalize(token);
+    return Index;
+}
+
+//  fieldFromName
+//
+// Return the field corresponding to a name used in a query
+//
+bool Query::fieldFromName(const QString& name, TB_FIELD* field)
+{
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (name.compare(TechnicalBulletin::fieldName(static_cast<TB_FIELD>(i)), Qt::CaseInsensitive) == 0) {
+            *field = static_cast<TB_FIELD>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+//  toString
+//
+// Canonical form of a node. Operands of AND and OR are sorted, so "a b" and "b a" give the same string
+//
+QString Query::toString(int index) const
+{
+    const QueryNode& Node = this->Nodes.at(index);
+
+    switch (Node.Type) {
+        case NODE_WORD:
+            return QString("%1%2%3").arg(Node.Fields).arg(QUERY_FIELD_SEPARATOR).arg(Node.Word);
+
+        case NODE_DATE:
+            return QString("date%1%2%3%4").arg(QUERY_FIELD_SEPARATOR).arg(Node.From.toString(Qt::ISODate), DATE_RANGE_SEPARATOR, Node.To.toString(Qt::ISODate));
+
+        case NODE_ALL:
+            return "*";
+
+        case NODE_NOT:
+            return QString("%1 %2").arg(OPERATOR_NOT, toString(Node.Children.first()));
+
+        case NODE_AND:
+        case NODE_OR: {
+            QStringList Operands;
+            for (int i = 0; i < Node.Children.count(); i++) {
+                Operands << toString(Node.Children.at(i));
+            }
+            Operands.sort();
+            return QString("(%1)").arg(Operands.join(Node.Type == NODE_AND ? " " OPERATOR_AND " " : " " OPERATOR_OR " "));
+        }
+    }
+
+    return QString();
+}
@@ -0,0 +1,105 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef QUERY_HPP
+#define QUERY_HPP
+
+#include "TechnicalBulletin.hpp"
+#include <QDate>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// Type of a query node
+typedef enum {
+    NODE_WORD, // Word searched in some fields
+    NODE_DATE, // Release date range
+    NODE_ALL,  // Every TB (empty query)
+    NODE_AND,
+    NODE_OR,
+    NODE_NOT
+} NODE_TYPE;
+
+//  QueryNode
+//
+// Node of the syntax tree of a query.
+// Children are referenced by their position in the node list of the query
+//
+struct QueryNode
+{
+    NODE_TYPE   Type;
+    QString     Word;     // NODE_WORD: normalized word
+    quint32     Fields;   // NODE_WORD: searched fields. 0 means the fields enabled in the settings
+    QDate       From;     // NODE_DATE: first day, invalid if the range is open
+    QDate       To;       // NODE_DATE: last day, invalid if the range is open
+    QStringList Terms;    // NODE_WORD: words of the dictionary matched by Word, set by the planner
+    QList<int>  Children; // NODE_AND, NODE_OR, NODE_NOT
+    qint64      Cost;     // Estimated number of matching TB, set by the planner
+};
+
+//  Query
+//
+// Syntax tree of a search query. Grammar:
+//
+//   query   := and ( "OR" and )*
+//   and     := unary ( ["AND"] unary )*      Words without operator are ANDed
+//   unary   := ( "NOT" | "-" ) unary | primary
+//   primary := "(" query ")" | [field ":"] word
+//
+// Fields: number, title, category, rk, techpub, date, registeredby, replaces, replacedby, notes, keywords
+// date: also accepts ranges, eg. date:2022-01..2023-06
+// Operators must be written in upper case, "and" or "or" are searched as words.
+// The parser never fails: unbalanced parentheses are closed implicitly, stray ones are ignored
+//
+class Query
+{
+  public:
+    Query(const QString& text);
+
+    int              root() const { return this->Root; }
+    const QueryNode& node(int index) const { return this->Nodes.at(index); }
+    QueryNode&       node(int index) { return this->Nodes[index]; }
+    QString          normalized() const { return toString(this->Root); }
+
+    static bool fieldFromName(const QString& name, TB_FIELD* field);
+
+  private:
+    QList<QueryNode> Nodes;
+    QStringList      Tokens;
+    int              Position;
+    int              Root;
+
+    int addNode(NODE_TYPE type);
+    int parseOr();
+    int parseAnd();
+    int parseUnary();
+    int parsePrimary();
+    int parseWord(const QString& token);
+
+    bool    atEnd() const { return this->Position >= this->Tokens.count(); }
+    QString toString(int index) const;
+};
+
+// Query separators
+#define QUERY_FIELD_SEPARATOR ':'
+#define QUERY_NOT_PREFIX      '-'
+
+#endif // QUERY_HPP
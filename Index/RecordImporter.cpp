@@ -0,0 +1,346 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "RecordImporter.hpp"
+#include "Global.hpp"
+#include "Query.hpp"
+#include "TBExporter.hpp"
+#include "ThreadIndex.hpp"
+#include <QDate>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+
+RecordImporter::RecordImporter(QPromise<ImportBatch>& promise, QFile& file)
+    : Promise(promise)
+    , File(file)
+    , Line(0)
+    , RecordLine(0)
+    , ErrorCount(0)
+{
+}
+
+//  import
+//
+// Read a file, in the format given by its extension. The progress is the number of KiB read
+//
+void RecordImporter::import(QPromise<ImportBatch>& promise, const QString& path)
+{
+    QFile File(path);
+    if (!File.open(QIODevice::ReadOnly)) {
+        ImportBatch Batch;
+        Batch.Errors << QString("Impossible to open %1").arg(path);
+        promise.addResult(Batch);
+        return;
+    }
+    promise.setProgressRange(0, static_cast<int>(File.size() / IMPORT_PROGRESS_UNIT));
+
+    RecordImporter Importer(promise, File);
+    if (path.endsWith(JSON_LINES_EXTENSION, Qt::CaseInsensitive)) {
+        Importer.readJsonLines();
+    }
+    else {
+        Importer.readCsv();
+    }
+    Importer.flush(true);
+}
+
+//  readCsv
+//
+// Read a CSV file. The first record is the header, naming the columns.
+// The separator is a comma, or a semicolon (spreadsheets using the decimal comma)
+//
+void RecordImporter::readCsv()
+{
+    QByteArray Record;
+    if (!readCsvRecord(Record)) {
+        error("Empty file");
+        return;
+    }
+    if (Record.startsWith(UTF8_BOM)) {
+        Record.remove(0, sizeof(UTF8_BOM) - 1);
+    }
+
+    char        Separator = Record.count(';') > Record.count(CSV_SEPARATOR) ? ';' : CSV_SEPARATOR;
+    QStringList Header    = splitCsvRecord(Record, Separator);
+
+    // Field of each column, -1 if the column is ignored
+    QList<int> Columns;
+    for (int i = 0; i < Header.count(); i++) {
+        TB_FIELD Field;
+        Columns << (Query::fieldFromName(Header.at(i).trimmed(), &Field) ? static_cast<int>(Field) : -1);
+    }
+    if (!Columns.contains(FIELD_NUMBER)) {
+        error(QString("No '%1' column found").arg(TechnicalBulletin::fieldName(FIELD_NUMBER)));
+        return;
+    }
+
+    while (readCsvRecord(Record)) {
+        if (Record.trimmed().isEmpty()) {
+            continue;
+        }
+
+        QStringList Cells = splitCsvRecord(Record, Separator);
+        QStringList Values(FIELD_COUNT);
+        for (int i = 0; (i < Cells.count()) && (i < Columns.count()); i++) {
+            if (Columns.at(i) != -1) {
+                Values[Columns.at(i)] = Cells.at(i);
+            }
+        }
+
+        addRecord(Values);
+        if (!flush(false)) {
+            return;
+        }
+    }
+}
+
+//  readCsvRecord
+//
+// Read the next record. A quoted field can contain new lines, so lines are read until the quotes are balanced.
+// The new lines are normalized, and the last one is removed
+//
+bool RecordImporter::readCsvRecord(QByteArray& record)
+{
+    record.clear();
+    this->RecordLine = this->Line + 1;
+
+    int Quotes = 0;
+    do {
+        if (this->File.atEnd()) {
+            return !record.isEmpty();
+        }
+
+        QByteArray Text = this->File.readLine();
+        this->Line++;
+        if (Text.endsWith("\r\n")) {
+            Text.chop(2);
+            Text += '\n';
+        }
+        Quotes += Text.count(CSV_QUOTE);
+        record += Text;
+    } while ((Quotes % 2) != 0);
+
+    if (record.endsWith('\n')) {
+        record.chop(1);
+    }
+    return true;
+}
+
+//  splitCsvRecord
+//
+// Split a record into fields. Quotes are removed, doubled quotes inside a quoted field are a single quote
+//
+QStringList RecordImporter::splitCsvRecord(const QByteArray& record, char separator)
+{
+    QStringList Fields;
+    QByteArray  Field;
+    bool        Quoted = false;
+
+    for (qsizetype i = 0; i < record.size(); i++) {
+        char Char = record.at(i);
+        if (Quoted) {
+            if (Char != CSV_QUOTE) {
+                Field += Char;
+            }
+            else if ((i + 1 < record.size()) && (record.at(i + 1) == CSV_QUOTE)) {
+                Field += CSV_QUOTE;
+                i++;
+            }
+            else {
+                Quoted = false;
+            }
+        }
+        else if (Char == CSV_QUOTE) {
+            Quoted = true;
+        }
+        else if (Char == separator) {
+            Fields << QString::fromUtf8(Field);
+            Field.clear();
+        }
+        else {
+            Field += Char;
+        }
+    }
+
+    Fields << QString::fromUtf8(Field);
+    return Fields;
+}
+
+//  readJsonLines
+//
+// Read a JSON Lines file: one object per line. Keywords can be an array or a string
+//
+void RecordImporter::readJsonLines()
+{
+    while (!this->File.atEnd()) {
+        QByteArray Text  = this->File.readLine().trimmed();
+        this->RecordLine = ++this->Line;
+        if (Text.isEmpty()) {
+            continue;
+        }
+
+        QJsonParseError Error;
+        QJsonDocument   Document = QJsonDocument::fromJson(Text, &Error);
+        if (!Document.isObject()) {
+            error(QString("Not a JSON object (%1)").arg(Error.errorString()));
+            continue;
+        }
+
+        QStringList Values = jsonValues(Document.object());
+        addRecord(Values);
+        if (!flush(false)) {
+            return;
+        }
+    }
+}
+
+//  jsonValues
+//
+// Return the text of each field of a JSON object. Unknown keys are ignored, keywords can be an array or a string
+//
+QStringList RecordImporter::jsonValues(const QJsonObject& object)
+{
+    QStringList Values(FIELD_COUNT);
+    for (auto Entry = object.constBegin(); Entry != object.constEnd(); ++Entry) {
+        TB_FIELD Field;
+        if (!Query::fieldFromName(Entry.key(), &Field)) {
+            continue;
+        }
+
+        if (Entry.value().isArray()) {
+            QStringList Words;
+            QJsonArray  Array = Entry.value().toArray();
+            for (int i = 0; i < Array.count(); i++) {
+                Words << Array.at(i).toString();
+            }
+            Values[Field] = Words.join(KEYWORD_SEPARATOR);
+        }
+        else {
+            Values[Field] = Entry.value().toVariant().toString();
+        }
+    }
+    return Values;
+}
+
+//  createTB
+//
+// Check a record, given as the text of each field, then create its TB.
+// Return nullptr and set the error message if the record is invalid
+//
+TechnicalBulletin* RecordImporter::createTB(const QStringList& values, QString* error)
+{
+    if (ThreadIndex::normalizeNumber(values.at(FIELD_NUMBER)).isEmpty()) {
+        *error = "No TB number";
+        return nullptr;
+    }
+
+    // An empty date is allowed, an invalid one is not
+    QDate   Date;
+    QString DateText = values.at(FIELD_RELEASE_DATE).trimmed();
+    if (!DateText.isEmpty()) {
+        Date = QDate::fromString(DateText, EXPORT_DATE_FORMAT);
+        if (!Date.isValid()) {
+            Date = QDate::fromString(DateText, IMPORT_ALTERNATIVE_DATE_FORMAT);
+        }
+        if (!Date.isValid()) {
+            *error = QString("Invalid release date: %1").arg(DateText);
+            return nullptr;
+        }
+    }
+
+    // Same convention as the other TB: no keyword is a single empty one
+    QList<QString> Keywords = values.at(FIELD_KEYWORDS).split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
+    if (Keywords.isEmpty()) {
+        Keywords << "";
+    }
+
+    return new TechnicalBulletin(values.at(FIELD_NUMBER).trimmed(),
+                                 values.at(FIELD_TITLE),
+                                 values.at(FIELD_CATEGORY),
+                                 values.at(FIELD_RK),
+                                 values.at(FIELD_TECH_PUB),
+                                 values.at(FIELD_COMMENT),
+                                 Date,
+                                 values.at(FIELD_REGISTERED_BY),
+                                 values.at(FIELD_REPLACES),
+                                 values.at(FIELD_REPLACED_BY),
+                                 Keywords);
+}
+
+//  addRecord
+//
+// Add a record to the current batch, unless it is invalid or its number was already read
+//
+void RecordImporter::addRecord(const QStringList& values)
+{
+    QString Number = ThreadIndex::normalizeNumber(values.at(FIELD_NUMBER));
+    if (this->Numbers.contains(Number)) {
+        error(QString("TB %1 is already present in the file").arg(values.at(FIELD_NUMBER).trimmed()));
+        return;
+    }
+
+    QString            Message;
+    TechnicalBulletin* TB = createTB(values, &Message);
+    if (TB == nullptr) {
+        error(Message);
+        return;
+    }
+
+    this->Numbers.insert(Number);
+    this->Batch.Bulletins << TB;
+}
+
+//  error
+//
+// Reject the current record
+//
+void RecordImporter::error(const QString& message)
+{
+    this->Batch.Rejected++;
+    if (this->ErrorCount++ < IMPORT_MAX_ERRORS) {
+        this->Batch.Errors << QString("Line %1: %2").arg(this->RecordLine).arg(message);
+    }
+}
+
+//  flush
+//
+// Send the current batch when it is full, or when the file is read.
+// Return false if the import was cancelled, the TB of the batch being deleted
+//
+bool RecordImporter::flush(bool last)
+{
+    if (this->Promise.isCanceled()) {
+        qDeleteAll(this->Batch.Bulletins);
+        this->Batch = ImportBatch();
+        return false;
+    }
+
+    if (last || (this->Batch.Bulletins.count() >= IMPORT_BATCH_SIZE)) {
+        this->Promise.setProgressValue(static_cast<int>(this->File.pos() / IMPORT_PROGRESS_UNIT));
+        if (!this->Promise.addResult(this->Batch)) {
+            qDeleteAll(this->Batch.Bulletins);
+        }
+        this->Batch = ImportBatch();
+    }
+    return true;
+}
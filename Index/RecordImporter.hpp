@@ -0,0 +1,101 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef RECORDIMPORTER_HPP
+#define RECORDIMPORTER_HPP
+
+#include "TechnicalBulletin.hpp"
+#include <QFile>
+#include <QJsonObject>
+#include <QList>
+#include <QPromise>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+//  ImportBatch
+//
+// TB read by the record importer, sent to the GUI thread to be added to the index at once.
+// The records which could not be imported are counted, and the first errors are reported
+//
+struct ImportBatch
+{
+    QList<TechnicalBulletin*> Bulletins;
+    QStringList               Errors;
+    int                       Rejected;
+
+    ImportBatch()
+        : Rejected(0)
+    {
+    }
+};
+
+//  RecordImporter
+//
+// Import TB from a CSV or a JSON Lines file, like the ones written by TBExporter.
+// The columns (CSV header) or the keys (JSON) are the field names used in the queries, unknown ones are ignored.
+// The file is streamed in a worker thread (see QtConcurrent::run): the records are read one by one,
+// checked (number present and unique in the file, valid release date), then sent as batches through the promise.
+// The uniqueness of the numbers in the index is checked by the GUI thread, when it adds a batch
+//
+class RecordImporter
+{
+  public:
+    static void               import(QPromise<ImportBatch>& promise, const QString& path);
+    static QStringList        jsonValues(const QJsonObject& object);
+    static TechnicalBulletin* createTB(const QStringList& values, QString* error);
+
+  private:
+    RecordImporter(QPromise<ImportBatch>& promise, QFile& file);
+
+    QPromise<ImportBatch>& Promise;
+    QFile&                 File;
+    ImportBatch            Batch;
+    QSet<QString>          Numbers;    // Numbers already read, to detect the duplicates in the file
+    int                    Line;       // Last line read
+    int                    RecordLine; // First line of the current record
+    int                    ErrorCount;
+
+    void               readCsv();
+    void               readJsonLines();
+    bool               readCsvRecord(QByteArray& record);
+    static QStringList splitCsvRecord(const QByteArray& record, char separator);
+    void               addRecord(const QStringList& values);
+    void               error(const QString& message);
+    bool               flush(bool last);
+};
+
+// Number of TB added to the index at once
+#define IMPORT_BATCH_SIZE 4096
+
+// Max number of errors reported, the next ones are only counted
+#define IMPORT_MAX_ERRORS 100
+
+// Progress unit (bytes)
+#define IMPORT_PROGRESS_UNIT 1024
+
+// Files read as JSON Lines, the other ones are read as CSV
+#define JSON_LINES_EXTENSION ".jsonl"
+
+// Alternative date format accepted, used by the TB table
+#define IMPORT_ALTERNATIVE_DATE_FORMAT "yyyy/MM/dd"
+
+#endif // RECORDIMPORTER_HPP
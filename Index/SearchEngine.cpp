@@ -0,0 +1,308 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "SearchEngine.hpp"
+#include "Global.hpp"
+#include "MemoryReport.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+
+SearchEngine::SearchEngine(const QList<TechnicalBulletin*>& bulletins,
+                           const TermDictionary&            dictionary,
+                           const DateIndex&                 dates,
+                           const quint64&                   generation,
+                           const bool&                      indexed,
+                           bool                             cached)
+    : Bulletins(bulletins)
+    , Dictionary(dictionary)
+    , Dates(dates)
+    , Generation(generation)
+    , Indexed(indexed)
+    , Scan(bulletins)
+    , Cached(cached)
+    , Cache(SEARCH_CACHE_SIZE)
+    , CacheGeneration(generation)
+{
+}
+
+//  search
+//
+// Parse, plan then execute a query, unless its result is already in cache.
+// Words which are not qualified by a field name are searched in the given fields
+//
+QBitArray SearchEngine::search(const QString& text, quint32 fields, bool wholeWords) const
+{
+    TRACE_SCOPE("Search");
+    // The index was modified since the results were cached
+    if (this->Cached && (this->CacheGeneration != this->Generation)) {
+        this->Cache.clear();
+        this->CacheBytes.clear();
+        this->CacheGeneration = this->Generation;
+    }
+
+    // The cache key uses the normalized query, so "a b" and "b  a" share the same result
+    Query   Tree(text);
+    QString Key = QString("%1|%2|%3|%4").arg(fields).arg(wholeWords ? 1 : 0).arg(this->Generation).arg(Tree.normalized());
+
+    QBitArray* CachedResult = this->Cached ? this->Cache.object(Key) : nullptr;
+    if (CachedResult != nullptr) {
+        return *CachedResult;
+    }
+
+    // Without index structures, the TB themselves are read
+    if (!this->Indexed) {
+        return this->Scan.execute(Tree, fields, wholeWords);
+    }
+
+    plan(Tree, Tree.root(), fields, wholeWords);
+    QBitArray Result = execute(Tree, Tree.root(), fields, wholeWords);
+    if (this->Cached) {
+        this->Cache.insert(Key, new QBitArray(Result));
+        this->CacheBytes.insert(Key, MemoryReport::stringBytes(Key) + sizeof(QBitArray) + MemoryReport::arrayBytes((Result.size() + 7) / 8 + 1, 1));
+
+        // Forget the results evicted by the insertion
+        if (this->CacheBytes.count() > this->Cache.count()) {
+            for (auto Entry = this->CacheBytes.begin(); Entry != this->CacheBytes.end();) {
+                if (this->Cache.contains(Entry.key())) {
+                    ++Entry;
+                }
+                else {
+                    Entry = this->CacheBytes.erase(Entry);
+                }
+            }
+        }
+    }
+    return Result;
+}
+
+//  allTB
+//
+// Return a bit array with every existing TB set. Removed TB are not set
+//
+QBitArray SearchEngine::allTB() const
+{
+    QBitArray All(this->Bulletins.count());
+    for (int i = 0; i < this->Bulletins.count(); i++) {
+        if (this->Bulletins.at(i) != nullptr) {
+            All.setBit(i);
+        }
+    }
+    return All;
+}
+
+//  plan
+//
+// Estimate the number of TB matched by each node, bottom-up. The dictionary words matched by each searched word
+// are resolved here, once, and reused by execute().
+// The operands of an AND are then sorted: most selective first, negations last
+//
+void SearchEngine::plan(Query& query, int index, quint32 fields, bool wholeWords) const
+{
+    QueryNode& Node  = query.node(index);
+    qint64     Total = this->Bulletins.count();
+
+    for (int i = 0; i < Node.Children.count(); i++) {
+        plan(query, Node.Children.at(i), fields, wholeWords);
+    }
+
+    switch (Node.Type) {
+        case NODE_WORD:
+            Node.Terms = this->Dictionary.matchingTerms(Node.Word, wholeWords);
+            Node.Cost  = std::min<qint64>(this->Dictionary.estimate(Node.Terms, Node.Fields != 0 ? Node.Fields : fields), Total);
+            break;
+
+        case NODE_DATE:
+            Node.Cost = this->Dates.count(Node.From, Node.To);
+            break;
+
+        case NODE_ALL:
+            Node.Cost = Total;
+            break;
+
+        case NODE_NOT:
+            Node.Cost = Total - query.node(Node.Children.first()).Cost;
+            break;
+
+        case NODE_OR:
+            Node.Cost = 0;
+            for (int i = 0; i < Node.Children.count(); i++) {
+                Node.Cost += query.node(Node.Children.at(i)).Cost;
+            }
+            Node.Cost = std::min(Node.Cost, Total);
+            break;
+
+        case NODE_AND: {
+            QList<int> Children = Node.Children;
+            std::stable_sort(Children.begin(), Children.end(), [&query](int a, int b) {
+                bool NegationA = query.node(a).Type == NODE_NOT;
+                bool NegationB = query.node(b).Type == NODE_NOT;
+                if (NegationA != NegationB) {
+                    return NegationB;
+                }
+                return query.node(a).Cost < query.node(b).Cost;
+            });
+
+            Node.Children = Children;
+            Node.Cost     = Total;
+            for (int i = 0; i < Children.count(); i++) {
+                Node.Cost = std::min(Node.Cost, query.node(Children.at(i)).Cost);
+            }
+            break;
+        }
+    }
+}
+
+//  execute
+//
+// Evaluate a planned node
+//
+QBitArray SearchEngine::execute(const Query& query, int index, quint32 fields, bool wholeWords) const
+{
+    const QueryNode& Node = query.node(index);
+
+    switch (Node.Type) {
+        case NODE_WORD: {
+            QBitArray Match(this->Bulletins.count());
+            this->Dictionary.collect(Node.Terms, Node.Fields != 0 ? Node.Fields : fields, Match);
+            return Match;
+        }
+
+        case NODE_DATE: {
+            QBitArray     Match(this->Bulletins.count());
+            QList<qint32> Ids = this->Dates.range(Node.From, Node.To);
+            for (int i = 0; i < Ids.count(); i++) {
+                Match.setBit(Ids.at(i));
+            }
+            return Match;
+        }
+
+        case NODE_ALL:
+            return allTB();
+
+        case NODE_NOT:
+            return allTB() & ~execute(query, Node.Children.first(), fields, wholeWords);
+
+        case NODE_OR: {
+            QBitArray Result(this->Bulletins.count());
+            for (int i = 0; i < Node.Children.count(); i++) {
+                Result |= execute(query, Node.Children.at(i), fields, wholeWords);
+            }
+            return Result;
+        }
+
+        case NODE_AND: {
+            // Operands are sorted, the first one is the most selective
+            QBitArray Result = execute(query, Node.Children.first(), fields, wholeWords);
+            for (int i = 1; (i < Node.Children.count()) && (Result.count(true) != 0); i++) {
+                Result &= execute(query, Node.Children.at(i), fields, wholeWords);
+            }
+            return Result;
+        }
+    }
+
+    return QBitArray(this->Bulletins.count());
+}
+
+//  matchSpans
+//
+// Return the parts of the fields of a TB which match the words of a query.
+// Only the words which make a TB match are reported, the negated ones are ignored.
+// The matching rules are the same as the ones of the search, so the spans are computed on the words of the fields
+//
+QList<MatchSpan> SearchEngine::matchSpans(const TechnicalBulletin* tb, const QString& text, quint32 fields, bool wholeWords) const
+{
+    QList<MatchSpan>        Spans;
+    QList<const QueryNode*> Words;
+    Query                   Tree(text);
+    positiveWords(Tree, Tree.root(), Words);
+    if (Words.isEmpty()) {
+        return Spans;
+    }
+
+    for (int Field = 0; Field < FIELD_COUNT; Field++) {
+        QString Text = TermDictionary::normalize(tb->fieldText(static_cast<TB_FIELD>(Field)));
+
+        // Walk the words of the field, keeping their position
+        int Start = 0;
+        while (Start < Text.length()) {
+            int End = Text.indexOf(KEYWORD_SEPARATOR, Start);
+            if (End == -1) {
+                End = Text.length();
+            }
+            QStringView Token = QStringView(Text).mid(Start, End - Start);
+
+            for (int i = 0; (i < Words.count()) && !Token.isEmpty(); i++) {
+                quint32 Mask = Words.at(i)->Fields != 0 ? Words.at(i)->Fields : fields;
+                if (!(Mask & FIELD_MASK(Field))) {
+                    continue;
+                }
+
+                const QString& Word = Words.at(i)->Word;
+                if (wholeWords) {
+                    if (Token == Word) {
+                        Spans << MatchSpan{static_cast<TB_FIELD>(Field), Start, static_cast<int>(Token.length())};
+                    }
+                }
+                else {
+                    for (qsizetype Position = Token.indexOf(Word); (Position != -1) && !Word.isEmpty(); Position = Token.indexOf(Word, Position + Word.length())) {
+                        Spans << MatchSpan{static_cast<TB_FIELD>(Field), Start + static_cast<int>(Position), static_cast<int>(Word.length())};
+                    }
+                }
+            }
+
+            Start = End + 1;
+        }
+    }
+
+    return Spans;
+}
+
+//  positiveWords
+//
+// Collect the word nodes of a query which are not under a negation
+//
+void SearchEngine::positiveWords(const Query& query, int index, QList<const QueryNode*>& words) const
+{
+    const QueryNode& Node = query.node(index);
+
+    if (Node.Type == NODE_WORD) {
+        words << &Node;
+    }
+    else if (Node.Type != NODE_NOT) {
+        for (int i = 0; i < Node.Children.count(); i++) {
+            positiveWords(query, Node.Children.at(i), words);
+        }
+    }
+}
+
+//  memoryUsage
+//
+// Return the memory used by the cached results. The sizes are recorded at insertion,
+// because reading the cache entries would change the eviction order
+//
+qint64 SearchEngine::memoryUsage() const
+{
+    qint64 Bytes = 0;
+    for (auto Entry = this->CacheBytes.constBegin(); Entry != this->CacheBytes.constEnd(); ++Entry) {
+        Bytes += Entry.value();
+    }
+    return Bytes;
+}
@@ -0,0 +1,95 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef SEARCHENGINE_HPP
+#define SEARCHENGINE_HPP
+
+#include "DateIndex.hpp"
+#include "ParallelScan.hpp"
+#include "Query.hpp"
+#include "TechnicalBulletin.hpp"
+#include "TermDictionary.hpp"
+#include <QBitArray>
+#include <QCache>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+//  MatchSpan
+//
+// Part of a field which matches a word of a query
+//
+struct MatchSpan
+{
+    TB_FIELD Field;
+    int      Offset; // Position in the text returned by TechnicalBulletin::fieldText()
+    int      Length;
+};
+
+//  SearchEngine
+//
+// Resolve a search query using the index structures, without reading the TB themselves.
+// The query is parsed, then planned: the operands of an AND are evaluated from the most selective
+// to the least one, and the evaluation stops as soon as nothing matches anymore.
+// The result is a bit array indexed by TB id. A set bit means that the TB matches.
+// The last results are kept in a LRU cache. The generation of the index is part of the cache key,
+// and the cache is flushed when it changes, so a modification of the index invalidates all the results.
+// Until the index structures are built, queries are evaluated by a parallel scan of the TB.
+// An engine without cache has no mutable state, so it can be used by several threads at once (see IndexSnapshot)
+//
+class SearchEngine
+{
+  public:
+    SearchEngine(const QList<TechnicalBulletin*>& bulletins,
+                 const TermDictionary&            dictionary,
+                 const DateIndex&                 dates,
+                 const quint64&                   generation,
+                 const bool&                      indexed,
+                 bool                             cached = true);
+
+    QBitArray        search(const QString& text, quint32 fields, bool wholeWords) const;
+    QList<MatchSpan> matchSpans(const TechnicalBulletin* tb, const QString& text, quint32 fields, bool wholeWords) const;
+    qint64           memoryUsage() const;
+
+  private:
+    const QList<TechnicalBulletin*>& Bulletins;
+    const TermDictionary&            Dictionary;
+    const DateIndex&                 Dates;
+    const quint64&                   Generation;
+    const bool&                      Indexed;
+    ParallelScan                     Scan;
+
+    // Result cache
+    bool                               Cached;
+    mutable QCache<QString, QBitArray> Cache;
+    mutable QHash<QString, qint64>     CacheBytes; // Size of the cached results, read without touching the cache order
+    mutable quint64                    CacheGeneration;
+
+    QBitArray allTB() const;
+    void      plan(Query& query, int index, quint32 fields, bool wholeWords) const;
+    QBitArray execute(const Query& query, int index, quint32 fields, bool wholeWords) const;
+    void      positiveWords(const Query& query, int index, QList<const QueryNode*>& words) const;
+};
+
+// Number of results kept in cache
+#define SEARCH_CACHE_SIZE 32
+
+#endif // SEARCHENGINE_HPP
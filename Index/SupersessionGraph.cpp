@@ -0,0 +1,263 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "SupersessionGraph.hpp"
+#include "MemoryReport.hpp"
+#include "ThreadIndex.hpp"
+#include <QSet>
+#include <algorithm>
+
+//  addTB
+//
+// Register the edges declared by a TB. Its number must already be in the number index
+//
+void SupersessionGraph::addTB(qint32 id, const TechnicalBulletin* tb, const QHash<QString, qint32>& numbers)
+{
+    QString Number = ThreadIndex::normalizeNumber(tb->number());
+    addEdge(ThreadIndex::normalizeNumber(tb->replaces()), Number);
+    addEdge(Number, ThreadIndex::normalizeNumber(tb->replacedBy()));
+
+    if (numbers.contains(Number)) {
+        this->Missing.remove(Number);
+    }
+    for (const QString& Reference : {ThreadIndex::normalizeNumber(tb->replaces()), ThreadIndex::normalizeNumber(tb->replacedBy())}) {
+        if (!Reference.isEmpty()) {
+            this->References[Reference] << id;
+            if (!numbers.contains(Reference)) {
+                this->Missing.insert(Reference);
+            }
+        }
+    }
+}
+
+//  removeTB
+//
+// Unregister the edges declared by a TB. The TB must still contain the data it had when it was added,
+// and its number must already be removed from the number index
+//
+void SupersessionGraph::removeTB(qint32 id, const TechnicalBulletin* tb, const QHash<QString, qint32>& numbers)
+{
+    QString Number = ThreadIndex::normalizeNumber(tb->number());
+    removeEdge(ThreadIndex::normalizeNumber(tb->replaces()), Number);
+    removeEdge(Number, ThreadIndex::normalizeNumber(tb->replacedBy()));
+
+    for (const QString& Reference : {ThreadIndex::normalizeNumber(tb->replaces()), ThreadIndex::normalizeNumber(tb->replacedBy())}) {
+        auto Entry = this->References.find(Reference);
+        if (Entry != this->References.end()) {
+            Entry->removeOne(id);
+            if (Entry->isEmpty()) {
+                this->References.erase(Entry);
+                this->Missing.remove(Reference);
+            }
+        }
+    }
+    if (!Number.isEmpty() && !numbers.contains(Number) && this->References.contains(Number)) {
+        this->Missing.insert(Number);
+    }
+}
+
+//  updateMissing
+//
+// Compute the referenced numbers absent from the index, eg. after the graph was built without the number index
+//
+void SupersessionGraph::updateMissing(const QHash<QString, qint32>& numbers)
+{
+    this->Missing.clear();
+    for (auto Entry = this->References.constBegin(); Entry != this->References.constEnd(); ++Entry) {
+        if (!numbers.contains(Entry.key())) {
+            this->Missing.insert(Entry.key());
+        }
+    }
+}
+
+void SupersessionGraph::clear()
+{
+    this->Next.clear();
+    this->Previous.clear();
+    this->References.clear();
+    this->Missing.clear();
+}
+
+// An edge declared twice (by both TB) is stored twice, so removing one declaration keeps the other
+void SupersessionGraph::addEdge(const QString& older, const QString& newer)
+{
+    if (!older.isEmpty() && !newer.isEmpty() && (older != newer)) {
+        this->Next.insert(older, newer);
+        this->Previous.insert(newer, older);
+    }
+}
+
+void SupersessionGraph::removeEdge(const QString& older, const QString& newer)
+{
+    auto Edge = this->Next.find(older, newer);
+    if (Edge != this->Next.end()) {
+        this->Next.erase(Edge);
+    }
+    auto Reverse = this->Previous.find(newer, older);
+    if (Reverse != this->Previous.end()) {
+        this->Previous.erase(Reverse);
+    }
+}
+
+//  latestVersion
+//
+// Follow the "replaced by" edges up to the last known version of a TB.
+// The result may be a number which is not present in the index
+//
+QString SupersessionGraph::latestVersion(const QString& number) const
+{
+    QString       Current = ThreadIndex::normalizeNumber(number);
+    QSet<QString> Visited; // Protection against inconsistent data creating a cycle
+
+    while (this->Next.contains(Current) && !Visited.contains(Current)) {
+        Visited.insert(Current);
+        Current = this->Next.value(Current);
+    }
+    return Current;
+}
+
+//  history
+//
+// Return all the versions of a TB, from the oldest to the latest
+//
+QStringList SupersessionGraph::history(const QString& number) const
+{
+    QString       Current = ThreadIndex::normalizeNumber(number);
+    QSet<QString> Visited;
+
+    // Go back to the oldest version
+    while (this->Previous.contains(Current) && !Visited.contains(Current)) {
+        Visited.insert(Current);
+        Current = this->Previous.value(Current);
+    }
+
+    // Then walk forward
+    QStringList History;
+    Visited.clear();
+    History << Current;
+    Visited.insert(Current);
+    while (this->Next.contains(Current) && !Visited.contains(this->Next.value(Current))) {
+        Current = this->Next.value(Current);
+        Visited.insert(Current);
+        History << Current;
+    }
+    return History;
+}
+
+//  brokenChains
+//
+// Return the ids of the TB which reference a replaced or replacing TB absent from the index.
+// Only the TB referencing a missing number are read
+//
+QList<qint32> SupersessionGraph::brokenChains() const
+{
+    QList<qint32> Broken;
+    for (const QString& Number : this->Missing) {
+        Broken << this->References.value(Number);
+    }
+    std::sort(Broken.begin(), Broken.end());
+    Broken.erase(std::unique(Broken.begin(), Broken.end()), Broken.end());
+    return Broken;
+}
+
+//  obsoleteTB
+//
+// Return the pairs (obsolete TB id, latest version id) for all the TB replaced by a TB present in the index.
+// The versions are compared by number, so a TB sharing its number with another one is not obsolete.
+// Missing intermediate versions are skipped. The latest present version of each number is memoized,
+// so the whole index is resolved in a single pass, each edge being followed once
+//
+QList<QPair<qint32, qint32>> SupersessionGraph::obsoleteTB(const QList<TechnicalBulletin*>& bulletins, const QHash<QString, qint32>& numbers) const
+{
+    QHash<QString, QString>      Latest; // Number -> its latest version present in the index, empty if none
+    QList<QPair<qint32, qint32>> Obsolete;
+
+    for (int i = 0; i < bulletins.count(); i++) {
+        if (bulletins.at(i) == nullptr) {
+            continue;
+        }
+
+        // Walk the chain until a number already resolved, or the end of the chain
+        QString       Number  = ThreadIndex::normalizeNumber(bulletins.at(i)->number());
+        QString       Current = Number;
+        QStringList   Path;
+        QSet<QString> Visited;
+        QString       Result;
+
+        while (true) {
+            if (Latest.contains(Current)) {
+                Result = Latest.value(Current);
+                break;
+            }
+            if (!this->Next.contains(Current) || Visited.contains(Current)) {
+                Path << Current;
+                break;
+            }
+            Visited.insert(Current);
+            Path << Current;
+            Current = this->Next.value(Current);
+        }
+
+        // Path compression: all the numbers of the path share the same latest version,
+        // unless a later part of the path is missing from the index
+        for (int j = Path.count() - 1; j >= 0; j--) {
+            if (Result.isEmpty() && numbers.contains(Path.at(j))) {
+                Result = Path.at(j);
+            }
+            Latest.insert(Path.at(j), Result);
+        }
+
+        // Obsolete only if replaced by another number present in the index
+        QString LatestNumber = Latest.value(Number);
+        if (!LatestNumber.isEmpty() && (LatestNumber != Number)) {
+            Obsolete << qMakePair(static_cast<qint32>(i), numbers.value(LatestNumber));
+        }
+    }
+
+    return Obsolete;
+}
+
+//  memoryUsage
+//
+// Estimate the memory used by the edges. Each value of a multi-hash is a node chained to the previous ones
+//
+qint64 SupersessionGraph::memoryUsage() const
+{
+    qint64 Bytes = 0;
+    for (const QMultiHash<QString, QString>* Edges : {&this->Next, &this->Previous}) {
+        QList<QString> Keys = Edges->uniqueKeys();
+        Bytes += MemoryReport::hashBytes(Keys.count(), Edges->capacity(), sizeof(QString) + sizeof(void*));
+        for (int i = 0; i < Keys.count(); i++) {
+            Bytes += MemoryReport::stringBytes(Keys.at(i));
+        }
+        for (auto Edge = Edges->constBegin(); Edge != Edges->constEnd(); ++Edge) {
+            Bytes += sizeof(QString) + sizeof(void*) + MemoryReport::stringBytes(Edge.value());
+        }
+    }
+
+    // Referenced numbers. The missing ones share their strings with the references
+    Bytes += MemoryReport::hashBytes(this->References.count(), this->References.capacity(), sizeof(QString) + sizeof(QList<qint32>));
+    for (auto Entry = this->References.constBegin(); Entry != this->References.constEnd(); ++Entry) {
+        Bytes += MemoryReport::stringBytes(Entry.key()) + MemoryReport::arrayBytes(Entry->capacity(), sizeof(qint32));
+    }
+    Bytes += MemoryReport::hashBytes(this->Missing.count(), this->Missing.capacity(), sizeof(QString));
+    return Bytes;
+}
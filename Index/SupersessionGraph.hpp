@@ -0,0 +1,66 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef SUPERSESSIONGRAPH_HPP
+#define SUPERSESSIONGRAPH_HPP
+
+#include "TechnicalBulletin.hpp"
+#include <QHash>
+#include <QList>
+#include <QMultiHash>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+//  SupersessionGraph
+//
+// Graph of the "replaces / replaced by" relations between TB numbers.
+// An edge A -> B means that B replaces A. It can be declared by A (Replaced by: B), by B (Replaces: A), or both.
+// Numbers are normalized like in the number index, which is given to the methods which need to know if a number is present.
+// Queries follow the edges, so their cost depends on the chain length, not on the index size.
+// The referenced numbers absent from the index (broken chains) are kept up to date when the TB are added and removed
+//
+class SupersessionGraph
+{
+  public:
+    void addTB(qint32 id, const TechnicalBulletin* tb, const QHash<QString, qint32>& numbers);
+    void removeTB(qint32 id, const TechnicalBulletin* tb, const QHash<QString, qint32>& numbers);
+    void updateMissing(const QHash<QString, qint32>& numbers);
+    void clear();
+
+    QString                      latestVersion(const QString& number) const;
+    QStringList                  history(const QString& number) const;
+    QList<qint32>                brokenChains() const;
+    QList<QPair<qint32, qint32>> obsoleteTB(const QList<TechnicalBulletin*>& bulletins, const QHash<QString, qint32>& numbers) const;
+    qint64                       memoryUsage() const;
+
+  private:
+    QMultiHash<QString, QString>  Next;       // A -> B: B replaces A
+    QMultiHash<QString, QString>  Previous;   // B -> A: B replaces A
+    QHash<QString, QList<qint32>> References; // Number -> ids of the TB which declare it as replaced or replacing
+    QSet<QString>                 Missing;    // Referenced numbers absent from the index
+
+    void addEdge(const QString& older, const QString& newer);
+    void removeEdge(const QString& older, const QString& newer);
+};
+
+#endif // SUPERSESSIONGRAPH_HPP
@@ -0,0 +1,174 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "TBExporter.hpp"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+//  exportTB
+//
+// Write the TB of a snapshot to a file, in index order. Only the TB whose bit is set are written, all of them if the filter is null.
+// The file is replaced only if the export succeeds.
+// The result is false if the file could not be written. Nothing is reported if the export is cancelled
+//
+void TBExporter::exportTB(QPromise<bool>& promise, QSharedPointer<const IndexSnapshot> snapshot, const QBitArray& filter, const QString& path, EXPORT_FORMAT format)
+{
+    QSaveFile File(path);
+    if (!File.open(QIODevice::WriteOnly)) {
+        promise.addResult(false);
+        return;
+    }
+
+    // The BOM allows the spreadsheets to detect UTF-8
+    QByteArray Buffer;
+    Buffer.reserve(EXPORT_BUFFER_SIZE * 2);
+    if (format == EXPORT_CSV) {
+        Buffer += UTF8_BOM;
+        Buffer += csvHeader();
+    }
+
+    int Total   = filter.isNull() ? snapshot->count() : static_cast<int>(filter.count(true));
+    int Written = 0;
+    promise.setProgressRange(0, Total);
+    for (qint32 Id = 0; Id < snapshot->size(); Id++) {
+        const TechnicalBulletin* TB = snapshot->tb(Id);
+        if ((TB == nullptr) || (!filter.isNull() && ((Id >= filter.size()) || !filter.testBit(Id)))) {
+            continue;
+        }
+        Buffer += format == EXPORT_CSV ? csvRecord(*TB) : jsonRecord(*TB);
+
+        // Flush the buffer when it is full, keeping its capacity
+        if (Buffer.size() >= EXPORT_BUFFER_SIZE) {
+            if (File.write(Buffer) != Buffer.size()) {
+                promise.addResult(false);
+                return;
+            }
+            Buffer.resize(0);
+        }
+
+        if ((Written++ % EXPORT_PROGRESS_STEP) == 0) {
+            if (promise.isCanceled()) {
+                return;
+            }
+            promise.setProgressValue(Written);
+        }
+    }
+
+    bool Success = (File.write(Buffer) == Buffer.size()) && File.commit();
+    promise.setProgressValue(Total);
+    promise.addResult(Success);
+}
+
+//  csvHeader
+//
+// Return the first line of a CSV file, naming the fields
+//
+QByteArray TBExporter::csvHeader()
+{
+    QByteArray Header;
+    for (int Field = 0; Field < FIELD_COUNT; Field++) {
+        if (Field != 0) {
+            Header += CSV_SEPARATOR;
+        }
+        appendCsvField(Header, TechnicalBulletin::fieldName(static_cast<TB_FIELD>(Field)));
+    }
+    return Header + CSV_EOL;
+}
+
+//  csvRecord
+//
+// Return the CSV line of a TB
+//
+QByteArray TBExporter::csvRecord(const TechnicalBulletin& tb)
+{
+    QByteArray Record;
+    for (int Field = 0; Field < FIELD_COUNT; Field++) {
+        if (Field != 0) {
+            Record += CSV_SEPARATOR;
+        }
+        appendCsvField(Record, fieldValue(tb, static_cast<TB_FIELD>(Field)));
+    }
+    return Record + CSV_EOL;
+}
+
+//  appendCsvField
+//
+// Append a field to a CSV record. A field containing a separator, a quote or a new line is quoted,
+// its quotes being doubled
+//
+void TBExporter::appendCsvField(QByteArray& record, const QString& text)
+{
+    QByteArray Field = text.toUtf8();
+    if (!Field.contains(CSV_SEPARATOR) && !Field.contains(CSV_QUOTE) && !Field.contains('\n') && !Field.contains('\r')) {
+        record += Field;
+        return;
+    }
+
+    record += CSV_QUOTE;
+    record += Field.replace(CSV_QUOTE, QByteArray(2, CSV_QUOTE));
+    record += CSV_QUOTE;
+}
+
+//  jsonRecord
+//
+// Return the JSON Lines record of a TB: a single line object
+//
+QByteArray TBExporter::jsonRecord(const TechnicalBulletin& tb)
+{
+    return QJsonDocument(jsonObject(tb)).toJson(QJsonDocument::Compact) + '\n';
+}
+
+//  jsonObject
+//
+// Return the JSON object describing a TB. Keywords are an array
+//
+QJsonObject TBExporter::jsonObject(const TechnicalBulletin& tb)
+{
+    QJsonObject Object;
+    for (int Field = 0; Field < FIELD_COUNT; Field++) {
+        if (Field != FIELD_KEYWORDS) {
+            Object.insert(TechnicalBulletin::fieldName(static_cast<TB_FIELD>(Field)), fieldValue(tb, static_cast<TB_FIELD>(Field)));
+        }
+    }
+    QJsonArray     Keywords;
+    QList<QString> List = tb.keywords();
+    for (int i = 0; i < List.count(); i++) {
+        if (!List.at(i).isEmpty()) {
+            Keywords.append(List.at(i));
+        }
+    }
+    Object.insert(TechnicalBulletin::fieldName(FIELD_KEYWORDS), Keywords);
+    return Object;
+}
+
+//  fieldValue
+//
+// Return the exported text of a field. Unlike in the UI, the release date has a fixed format
+//
+QString TBExporter::fieldValue(const TechnicalBulletin& tb, TB_FIELD field)
+{
+    if (field == FIELD_RELEASE_DATE) {
+        return tb.releaseDate().toString(EXPORT_DATE_FORMAT);
+    }
+    return tb.fieldText(field);
+}
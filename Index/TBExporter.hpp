@@ -0,0 +1,77 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef TBEXPORTER_HPP
+#define TBEXPORTER_HPP
+
+#include "IndexSnapshot.hpp"
+#include "TechnicalBulletin.hpp"
+#include <QBitArray>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QPromise>
+#include <QSharedPointer>
+#include <QString>
+
+// Export formats
+typedef enum {
+    EXPORT_CSV,
+    EXPORT_JSON_LINES
+} EXPORT_FORMAT;
+
+//  TBExporter
+//
+// Export TB to a CSV or a JSON Lines file, one record per TB, the fields being named like in the queries.
+// The export runs in a worker thread (see QtConcurrent::run), on a snapshot of the index, so the index can be modified meanwhile.
+// The TB to export are selected by a bit array and read one at a time from the snapshot.
+// The records are written through a fixed size buffer, the file is never built in memory
+//
+class TBExporter
+{
+  public:
+    static void        exportTB(QPromise<bool>& promise, QSharedPointer<const IndexSnapshot> snapshot, const QBitArray& filter, const QString& path, EXPORT_FORMAT format);
+    static QByteArray  csvHeader();
+    static QByteArray  csvRecord(const TechnicalBulletin& tb);
+    static QByteArray  jsonRecord(const TechnicalBulletin& tb);
+    static QJsonObject jsonObject(const TechnicalBulletin& tb);
+    static QString     fieldValue(const TechnicalBulletin& tb, TB_FIELD field);
+
+  private:
+    static void appendCsvField(QByteArray& record, const QString& text);
+};
+
+// Size of the write buffer (bytes)
+#define EXPORT_BUFFER_SIZE (64 * 1024)
+
+// Number of records written between two progress reports
+#define EXPORT_PROGRESS_STEP 256
+
+// Date format in the exported files
+#define EXPORT_DATE_FORMAT "yyyy-MM-dd"
+
+// CSV
+#define CSV_SEPARATOR ','
+#define CSV_QUOTE     '"'
+#define CSV_EOL       "\r\n"
+#define UTF8_BOM      "\xEF\xBB\xBF"
+
+#endif // TBEXPORTER_HPP
@@ -21,69 +21,120 @@
 
 #include "TechnicalBulletin.hpp"
 #include "Global.hpp"
-#include <algorithm>
+#include "Trace.hpp"
+#include <array>
 #include <QByteArrayView>
 
+// Labels of the subscription mails
+typedef enum {
+    LABEL_NUMBER,
+    LABEL_TITLE,
+    LABEL_CATEGORY,
+    LABEL_RK,
+    LABEL_TECHPUB,
+    LABEL_REGISTERED_BY,
+    LABEL_REPLACES,
+    LABEL_REPLACED_BY,
+    LABEL_COMMENTS,
+    LABEL_RELEASE_DATE,
+    LABEL_COUNT
+} MAIL_LABEL;
+
+// A value follows the first tab after its label, and ends at a tab and/or a new line
+struct MailLabel
+{
+    QByteArrayView Text;
+    bool           EndsAtTab;
+    bool           EndsAtNewLine;
+};
+
+static const MailLabel MailLabels[LABEL_COUNT] = {
+    {"Bulletin No:", true, true},
+    {"Title:", true, true},
+    {"TB Category:", true, true},
+    {"Rebuilding Kit(s):", true, true},
+    {"Technical Publication(s):", true, true},
+    {"Registered by:", true, true},
+    {"Replaces:", true, true},
+    {"Replaced by:", true, true},
+    {"Comments:", true, false}, // Comments can be written over several lines
+    {"Release date:", false, true},
+};
+
+// For each byte, mask of the labels beginning with it
+static const std::array<quint16, 256> LabelsByFirstChar = []() {
+    std::array<quint16, 256> Table {};
+    for (int i = 0; i < LABEL_COUNT; i++) {
+        Table[static_cast<uchar>(MailLabels[i].Text.front())] |= 1 << i;
+    }
+    return Table;
+}();
+
 //  TechnicalBulletin
 //
 // Create a TB using dropped data
 // This constructor is designed to handle standard mails sent via the
-// subscription list
+// subscription list.
+// The mail is read in a single pass: only the bytes which can begin a label are compared to the labels,
+// and the scan resumes after each label found. Only the first occurrence of a label is used
 //
 TechnicalBulletin::TechnicalBulletin(QByteArray data)
 {
-    qsizetype Start, End;
-
-    // Parse most of the strings
-    QList<QString> Strings;
-    QList<QString> StringLabels;
-    StringLabels << "Bulletin No:"
-                 << "Title:"
-                 << "TB Category:"
-                 << "Rebuilding Kit(s):"
-                 << "Technical Publication(s):"
-                 << "Registered by:"
-                 << "Replaces:"
-                 << "Replaced by:";
-
-    for (int i = 0; i < StringLabels.count(); i++) {
-        Start = data.indexOf(QByteArrayView(StringLabels.at(i).toUtf8())); // Look for a label
-        if (Start == -1) {
-            // No label found, don't write anything in the field
-            Strings << "";
+    TRACE_SCOPE("Parse mail");
+    QByteArrayView Mail(data);
+    QByteArrayView Values[LABEL_COUNT];
+    quint16        Missing = (1 << LABEL_COUNT) - 1;
+
+    qsizetype Position = 0;
+    while ((Position < Mail.size()) && (Missing != 0)) {
+        // Look for a label beginning here
+        quint16 Candidates = LabelsByFirstChar[static_cast<uchar>(Mail.at(Position))] & Missing;
+        int     Label      = 0;
+        for (; Candidates != 0; Label++, Candidates >>= 1) {
+            if ((Candidates & 1) && Mail.sliced(Position).startsWith(MailLabels[Label].Text)) {
+                break;
+            }
         }
-        else {
-            // Label found
-            Start = data.indexOf('\t', Start) + 1;                                  // Skip the label, and find the fist byte of the data string
-            End   = std::min(data.indexOf('\t', Start), data.indexOf('\n', Start)); // End of data string. May terminate with a Tab or a New Line
-            Strings << data.mid(Start, End - Start);                                // Grab and save data
+        if (Candidates == 0) {
+            Position++;
+            continue;
         }
-    }
+        Missing &= ~(1 << Label);
+        Position += MailLabels[Label].Text.size();
 
-    // Comment box. Don't fill it if no comment field is found
-    Start = data.indexOf("Comments:");
-    if (Start == -1) {
-        Start = 0;
-        End   = 0;
-    }
-    else {
-        Start = data.indexOf('\t', Start) + 1;
-        End   = data.indexOf('\t', Start);
-    }
-    QString Comment(data.mid(Start, End - Start));
+        // Skip the label up to the first byte of the value. No tab on the line of the label: the value stays empty
+        qsizetype LineEnd = Mail.indexOf('\n', Position);
+        qsizetype Start   = Mail.indexOf('\t', Position);
+        if ((Start == -1) || ((LineEnd != -1) && (Start > LineEnd))) {
+            continue;
+        }
+        Start++;
 
-    // Release date
-    Start = data.indexOf("Release date:");
-    Start = data.indexOf('\t', Start) + 1;
-    End   = data.indexOf('\n', Start);
-    QDate Date(QDate::fromString(data.mid(Start, End - Start), "yyyy-MM-dd"));
+        // Find the end of the value. The scan resumes after the label, because a value may span several lines
+        // (Comments) and hide the labels which follow it
+        qsizetype End = Start;
+        while ((End < Mail.size()) && !((Mail.at(End) == '\t') && MailLabels[Label].EndsAtTab) && !((Mail.at(End) == '\n') && MailLabels[Label].EndsAtNewLine)) {
+            End++;
+        }
+        Values[Label] = Mail.sliced(Start, End - Start);
+    }
 
     // Keywords
     QList<QString> Keywords;
     Keywords << "";
 
     // Save data into members
-    setData(Strings.at(0), Strings.at(1), Strings.at(2), Strings.at(3), Strings.at(4), Comment, Date, Strings.at(5), Strings.at(6), Strings.at(7), Keywords);
+    setData(QString::fromUtf8(Values[LABEL_NUMBER]),
+            QString::fromUtf8(Values[LABEL_TITLE]),
+            QString::fromUtf8(Values[LABEL_CATEGORY]),
+            QString::fromUtf8(Values[LABEL_RK]),
+            QString::fromUtf8(Values[LABEL_TECHPUB]),
+            QString::fromUtf8(Values[LABEL_COMMENTS]),
+            QDate::fromString(QString::fromLatin1(Values[LABEL_RELEASE_DATE]), "yyyy-MM-dd"),
+            QString::fromUtf8(Values[LABEL_REGISTERED_BY]),
+            QString::fromUtf8(Values[LABEL_REPLACES]),
+            QString::fromUtf8(Values[LABEL_REPLACED_BY]),
+            Keywords);
 }
 
 //  TechnicalBulletin
@@ -165,6 +216,65 @@ QString TechnicalBulletin::keywordsString() const
     return String;
 }
 
+//  fieldText
+//
+// Return the text of a field, as it is displayed in UI
+//
+QString TechnicalBulletin::fieldText(TB_FIELD field) const
+{
+    switch (field) {
+        case FIELD_NUMBER:
+            return this->Number;
+        case FIELD_TITLE:
+            return this->Title;
+        case FIELD_CATEGORY:
+            return this->Category;
+        case FIELD_RK:
+            return this->RK;
+        case FIELD_TECH_PUB:
+            return this->TechPub;
+        case FIELD_RELEASE_DATE:
+            return this->ReleaseDate.toString();
+        case FIELD_REGISTERED_BY:
+            return this->RegisteredBy;
+        case FIELD_REPLACES:
+            return this->Replaces;
+        case FIELD_REPLACED_BY:
+            return this->ReplacedBy;
+        case FIELD_COMMENT:
+            return this->Comment;
+        case FIELD_KEYWORDS:
+            return keywordsString();
+        default:
+            return QString();
+    }
+}
+
+//  fieldName
+//
+// Return the name of a field, as used in the queries and the exported files
+//
+QString TechnicalBulletin::fieldName(TB_FIELD field)
+{
+    static const char* FieldNames[FIELD_COUNT] = {"number", "title", "category", "rk", "techpub", "date", "registeredby", "replaces", "replacedby", "notes", "keywords"};
+    return (field >= 0) && (field < FIELD_COUNT) ? QString(FieldNames[field]) : QString();
+}
+
+//  fieldTokens
+//
+// Split a field into the words used by the search engine.
+// Keywords are already stored as a list, other fields are split on the keyword separator
+//
+QStringList TechnicalBulletin::fieldTokens(TB_FIELD field) const
+{
+    if (field == FIELD_KEYWORDS) {
+        QStringList Tokens(this->Keywords);
+        Tokens.removeAll(QString());
+        return Tokens;
+    }
+    return fieldText(field).split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
+}
+
 //  >>
 //
 // Unserialize a TB
@@ -27,6 +27,28 @@
 #include <QDate>
 #include <QList>
 #include <QString>
+#include <QStringList>
+
+// Searchable fields of a TB.
+// Used by the indexes and the search engine to know where a term was found
+typedef enum {
+    FIELD_NUMBER,
+    FIELD_TITLE,
+    FIELD_CATEGORY,
+    FIELD_RK,
+    FIELD_TECH_PUB,
+    FIELD_RELEASE_DATE,
+    FIELD_REGISTERED_BY,
+    FIELD_REPLACES,
+    FIELD_REPLACED_BY,
+    FIELD_COMMENT,
+    FIELD_KEYWORDS,
+    FIELD_COUNT
+} TB_FIELD;
+
+// Field masks, to select a set of fields in a single integer
+#define FIELD_MASK(field) (1u << (field))
+#define ALL_FIELDS_MASK   ((1u << FIELD_COUNT) - 1)
 
 //  TechnicalBulletin
 //
@@ -74,6 +96,11 @@ class TechnicalBulletin
 
     QString keywordsString() const;
 
+    QString     fieldText(TB_FIELD field) const;
+    QStringList fieldTokens(TB_FIELD field) const;
+
+    static QString fieldName(TB_FIELD field);
+
     void setKeywords(QList<QString> keywords) { this->Keywords = keywords; }
 
   private:
@@ -0,0 +1,254 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "TermDictionary.hpp"
+#include "MemoryReport.hpp"
+#include <algorithm>
+#include <QPair>
+
+// Return the distinct normalized words of a TB field
+static QStringList distinctTerms(const TechnicalBulletin* tb, TB_FIELD field)
+{
+    QStringList Terms = tb->fieldTokens(field);
+    for (int i = 0; i < Terms.count(); i++) {
+        Terms[i] = TermDictionary::normalize(Terms.at(i));
+    }
+    Terms.sort();
+    Terms.erase(std::unique(Terms.begin(), Terms.end()), Terms.end());
+    return Terms;
+}
+
+//  addTB
+//
+// Register all the words of a TB.
+// Ids are usually added in increasing order, so the insertion is most of the time a simple append
+//
+void TermDictionary::addTB(qint32 id, const TechnicalBulletin* tb)
+{
+    for (int Field = 0; Field < FIELD_COUNT; Field++) {
+        QStringList Words = distinctTerms(tb, static_cast<TB_FIELD>(Field));
+        for (int i = 0; i < Words.count(); i++) {
+            QList<qint32>& Postings = this->Terms[Words.at(i)].Postings[Field];
+            if (Postings.isEmpty() || (Postings.last() < id)) {
+                Postings.append(id);
+            }
+            else {
+                auto Position = std::lower_bound(Postings.begin(), Postings.end(), id);
+                if ((Position == Postings.end()) || (*Position != id)) {
+                    Postings.insert(Position, id);
+                }
+            }
+        }
+    }
+}
+
+//  removeTB
+//
+// Unregister all the words of a TB. The TB must still contain the data it had when it was added.
+// A word without any reference left is removed from the dictionary
+//
+void TermDictionary::removeTB(qint32 id, const TechnicalBulletin* tb)
+{
+    for (int Field = 0; Field < FIELD_COUNT; Field++) {
+        QStringList Words = distinctTerms(tb, static_cast<TB_FIELD>(Field));
+        for (int i = 0; i < Words.count(); i++) {
+            auto Entry = this->Terms.find(Words.at(i));
+            if (Entry == this->Terms.end()) {
+                continue;
+            }
+
+            QList<qint32>& Postings = Entry->Postings[Field];
+            auto           Position = std::lower_bound(Postings.begin(), Postings.end(), id);
+            if ((Position != Postings.end()) && (*Position == id)) {
+                Postings.erase(Position);
+            }
+
+            // Drop the word if it is not referenced anymore
+            bool Unused = true;
+            for (int j = 0; j < FIELD_COUNT; j++) {
+                if (!Entry->Postings[j].isEmpty()) {
+                    Unused = false;
+                    break;
+                }
+            }
+            if (Unused) {
+                this->Terms.erase(Entry);
+            }
+        }
+    }
+}
+
+void TermDictionary::clear()
+{
+    this->Terms.clear();
+}
+
+//  suggestions
+//
+// Return the words beginning with a prefix, the most frequent first.
+// Only the fields selected in the mask are taken into account.
+// The dictionary is sorted, so the candidates are a contiguous range starting at the prefix
+//
+QStringList TermDictionary::suggestions(const QString& prefix, quint32 fields, int count) const
+{
+    QString                    Prefix = normalize(prefix);
+    QList<QPair<int, QString>> Candidates;
+
+    for (auto Entry = this->Terms.lowerBound(Prefix); (Entry != this->Terms.end()) && Entry.key().startsWith(Prefix); ++Entry) {
+        int Frequency = 0;
+        for (int Field = 0; Field < FIELD_COUNT; Field++) {
+            if (fields & FIELD_MASK(Field)) {
+                Frequency += Entry->Postings[Field].count();
+            }
+        }
+        if (Frequency != 0) {
+            Candidates << qMakePair(Frequency, Entry.key());
+        }
+    }
+
+    // Keep only the best candidates. Same frequency: alphabetical order
+    int Count = std::min(count, static_cast<int>(Candidates.count()));
+    std::partial_sort(Candidates.begin(), Candidates.begin() + Count, Candidates.end(), [](const QPair<int, QString>& a, const QPair<int, QString>& b) {
+        return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second));
+    });
+
+    QStringList Suggestions;
+    for (int i = 0; i < Count; i++) {
+        Suggestions << Candidates.at(i).second;
+    }
+    return Suggestions;
+}
+
+//  frequency
+//
+// Return the number of references of a word in the selected fields
+//
+int TermDictionary::frequency(const QString& term, quint32 fields) const
+{
+    int  Frequency = 0;
+    auto Entry     = this->Terms.constFind(normalize(term));
+    if (Entry != this->Terms.constEnd()) {
+        for (int Field = 0; Field < FIELD_COUNT; Field++) {
+            if (fields & FIELD_MASK(Field)) {
+                Frequency += Entry->Postings[Field].count();
+            }
+        }
+    }
+    return Frequency;
+}
+
+//  matchingTerms
+//
+// Return the words of the dictionary matched by a searched word.
+// Whole word: the word itself, if it is in the dictionary. Partial match: every word containing it.
+// A query resolves its words once, then uses them to plan and to execute the search
+//
+QStringList TermDictionary::matchingTerms(const QString& word, bool wholeWord) const
+{
+    QStringList Terms;
+    QString     Word = normalize(word);
+    if (wholeWord) {
+        if (this->Terms.contains(Word)) {
+            Terms << Word;
+        }
+        return Terms;
+    }
+
+    for (auto Entry = this->Terms.constBegin(); Entry != this->Terms.constEnd(); ++Entry) {
+        if (Entry.key().contains(Word)) {
+            Terms << Entry.key();
+        }
+    }
+    return Terms;
+}
+
+//  estimate
+//
+// Estimate the number of TB matched by some words of the dictionary, used to plan a search.
+// A TB is counted once per matching word, so it is an upper bound
+//
+int TermDictionary::estimate(const QStringList& terms, quint32 fields) const
+{
+    int Estimate = 0;
+    for (int i = 0; i < terms.count(); i++) {
+        auto Entry = this->Terms.constFind(terms.at(i));
+        if (Entry == this->Terms.constEnd()) {
+            continue;
+        }
+        for (int Field = 0; Field < FIELD_COUNT; Field++) {
+            if (fields & FIELD_MASK(Field)) {
+                Estimate += Entry->Postings[Field].count();
+            }
+        }
+    }
+    return Estimate;
+}
+
+//  postings
+//
+// Return the sorted ids of the TB containing a word in a given field
+//
+QList<qint32> TermDictionary::postings(const QString& term, TB_FIELD field) const
+{
+    auto Entry = this->Terms.constFind(normalize(term));
+    if (Entry == this->Terms.constEnd()) {
+        return QList<qint32>();
+    }
+    return Entry->Postings[field];
+}
+
+//  collect
+//
+// Set the bits of the TB containing some words of the dictionary (see matchingTerms()) in the selected fields
+//
+void TermDictionary::collect(const QStringList& terms, quint32 fields, QBitArray& result) const
+{
+    for (int i = 0; i < terms.count(); i++) {
+        auto Entry = this->Terms.constFind(terms.at(i));
+        if (Entry == this->Terms.constEnd()) {
+            continue;
+        }
+        for (int Field = 0; Field < FIELD_COUNT; Field++) {
+            if (fields & FIELD_MASK(Field)) {
+                const QList<qint32>& Postings = Entry->Postings[Field];
+                for (int j = 0; j < Postings.count(); j++) {
+                    result.setBit(Postings.at(j));
+                }
+            }
+        }
+    }
+}
+
+//  memoryUsage
+//
+// Estimate the memory used by the dictionary: map nodes, words and postings
+//
+qint64 TermDictionary::memoryUsage() const
+{
+    qint64 Bytes = 0;
+    for (auto Entry = this->Terms.constBegin(); Entry != this->Terms.constEnd(); ++Entry) {
+        Bytes += MEMORY_MAP_NODE_OVERHEAD + sizeof(QString) + sizeof(TermEntry) + MemoryReport::stringBytes(Entry.key());
+        for (int Field = 0; Field < FIELD_COUNT; Field++) {
+            Bytes += MemoryReport::arrayBytes(Entry->Postings[Field].capacity(), sizeof(qint32));
+        }
+    }
+    return Bytes;
+}
@@ -0,0 +1,66 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef TERMDICTIONARY_HPP
+#define TERMDICTIONARY_HPP
+
+#include "TechnicalBulletin.hpp"
+#include <QBitArray>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+//  TermDictionary
+//
+// Sorted dictionary of all the words found in the TB fields.
+// For each word and each field, it keeps the sorted list of the TB ids containing it,
+// so the size of these lists gives the document frequency of the word.
+// It is updated incrementally when a TB is added, edited or removed
+//
+class TermDictionary
+{
+  public:
+    void addTB(qint32 id, const TechnicalBulletin* tb);
+    void removeTB(qint32 id, const TechnicalBulletin* tb);
+    void clear();
+
+    QStringList   suggestions(const QString& prefix, quint32 fields, int count) const;
+    int           frequency(const QString& term, quint32 fields) const;
+    QStringList   matchingTerms(const QString& word, bool wholeWord) const;
+    int           estimate(const QStringList& terms, quint32 fields) const;
+    QList<qint32> postings(const QString& term, TB_FIELD field) const;
+    void          collect(const QStringList& terms, quint32 fields, QBitArray& result) const;
+    int           termCount() const { return this->Terms.count(); }
+    qint64        memoryUsage() const;
+
+    static QString normalize(const QString& term) { return term.toLower(); }
+
+  private:
+    struct TermEntry
+    {
+        QList<qint32> Postings[FIELD_COUNT];
+    };
+
+    QMap<QString, TermEntry> Terms;
+};
+
+#endif // TERMDICTIONARY_HPP
@@ -20,30 +20,42 @@
  */
 
 #include "ThreadIndex.hpp"
-#include "../UI/MainWindow.hpp"
+#include "IndexSnapshot.hpp"
+#include "Trace.hpp"
 #include <QDataStream>
+#include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
+#include <utility>
 
-ThreadIndex::ThreadIndex(MainWindow* MainWindowPtr, bool ForceIndexCheck)
-    : MainWindowPtr(MainWindowPtr)
-    , ForceIndexCheck(ForceIndexCheck)
+ThreadIndex::ThreadIndex(bool ForceIndexCheck, const QString& FileName)
+    : ForceIndexCheck(ForceIndexCheck)
+    , FileName(FileName)
     , Modified(false)
+    , Generation(0)
+    , Indexed(false)
+    , Engine(Bulletins, Dictionary, Dates, Generation, Indexed)
 {
-    // Connections
-    connect(this->MainWindowPtr, &MainWindow::save, this, [this](bool backup) { save(backup); });
+    // The loaded data are installed in the GUI thread, which owns them
+    connect(this, &ThreadIndex::chunkLoaded, this, [this](const QList<TechnicalBulletin*>& chunk) { appendChunk(chunk); }, Qt::QueuedConnection);
+    connect(this, &ThreadIndex::structuresBuilt, this, [this](IndexStructures* structures) { installStructures(structures); }, Qt::QueuedConnection);
 }
 
 ThreadIndex::~ThreadIndex()
 {
-    // Destroy index data
+    // The TB are owned by the store, and possibly shared with snapshots
 }
 
 void ThreadIndex::run()
 {
+    Trace::setThreadName("Index");
+    TraceScope Opening("Open index");
+
     // Try to open the index if one exists
-    if (QFileInfo::exists(TBI_FILENAME)) {
-        QFile file(TBI_FILENAME);
+    bool Built = false; // The structures were built with the TB read
+    if (QFileInfo::exists(this->FileName)) {
+        QFile file(this->FileName);
         if (file.open(QIODevice::ReadOnly)) {
             QDataStream Stream(&file);
 
@@ -70,18 +82,23 @@ void ThreadIndex::run()
                 if (Stream.status() == QDataStream::Ok) {
                     if (Magic == QString(TBI_MAGIC)) {
                         // If the magic is valid, read the version and the TB count, then open the file according to it
+                        bool Success;
                         Stream >> Version >> Count;
                         emit openingIndex(Version, Count);
 
                         switch (Version) {
 
                             case 1:
-                                if (readIndexV1(Count, Stream, ForceIndexCheck)) {
+                                Success = readIndexV1(Count, Stream, ForceIndexCheck);
+                                flushTB();
+                                emit structuresBuilt(buildStructures(this->Loaded));
+                                Built = true;
+                                if (Success) {
                                     emit indexOpenedSuccessfully(Count);
                                 }
                                 else {
                                     this->Modified = true; // File partially opened
-                                    emit indexReadingFailed(this->Bulletins.count());
+                                    emit indexReadingFailed(this->Loaded.count());
                                 }
                                 break;
 
@@ -100,18 +117,22 @@ void ThreadIndex::run()
                 // But don't throw a message, it just means that it was an empty and unversionned file.
                 // Legacy code from MainWindow.cpp:
                 // else {
-                //     QMessageBox::critical(this, WINDOW_TITLE, tr("Invalid file %1").arg(TBI_FILENAME));
+                //     QMessageBox::critical(this, WINDOW_TITLE, tr("Invalid file %1").arg(this->FileName));
                 // }
             }
 
             // If count != 0, it's an old file, no doubt.
             else {
-                if (readIndexV0(Count, Stream, ForceIndexCheck)) {
+                bool Success = readIndexV0(Count, Stream, ForceIndexCheck);
+                flushTB();
+                emit structuresBuilt(buildStructures(this->Loaded));
+                Built = true;
+                if (Success) {
                     emit indexOpenedSuccessfully(Count);
                 }
                 else {
                     this->Modified = true; // File partially opened
-                    emit indexReadingFailed(this->Bulletins.count());
+                    emit indexReadingFailed(this->Loaded.count());
                 }
             }
         }
@@ -127,17 +148,101 @@ void ThreadIndex::run()
         emit noIndexFound();
     }
 
+    // No file, or a file which could not be read: the structures are empty but usable
+    if (!Built) {
+        emit structuresBuilt(buildStructures(this->Loaded));
+    }
+
     // Finally, run the event loop to handle the signals emitted by the GUI
+    Opening.end();
     emit openingComplete();
     exec();
 }
 
+//  publishTB
+//
+// Called by the loading thread for each TB read. The TB are sent to the GUI thread by chunks:
+// a small one first, to display a screenful as soon as possible, then bigger ones
+//
+void ThreadIndex::publishTB(TechnicalBulletin* tb)
+{
+    this->Loaded << tb;
+    this->Pending << tb;
+    if ((this->Loaded.count() == FIRST_CHUNK_SIZE) || (this->Pending.count() == LOAD_CHUNK_SIZE)) {
+        flushTB();
+    }
+}
+
+//  flushTB
+//
+// Send the TB read since the last chunk to the GUI thread
+//
+void ThreadIndex::flushTB()
+{
+    if (!this->Pending.isEmpty()) {
+        emit chunkLoaded(this->Pending);
+        this->Pending.clear();
+    }
+}
+
+//  appendChunk
+//
+// Executed in the GUI thread: append a chunk of loaded TB to the index and register their numbers.
+// Until the structures are installed, the search engine scans the TB already appended
+//
+void ThreadIndex::appendChunk(const QList<TechnicalBulletin*>& chunk)
+{
+    TRACE_SCOPE("Append loaded chunk");
+    for (int i = 0; i < chunk.count(); i++) {
+        addNumber(this->Bulletins.count(), chunk.at(i));
+        this->Bulletins << chunk.at(i);
+        this->Store << QSharedPointer<TechnicalBulletin>(chunk.at(i));
+    }
+    this->Generation++;
+    emit tbAvailable(this->Bulletins.count());
+}
+
+//  buildStructures
+//
+// Executed by the loading thread: build the term dictionary, the date index and the supersession graph of the loaded TB.
+// The ids are the positions in the loaded list, which are the ones of the index once all the chunks are appended
+//
+IndexStructures* ThreadIndex::buildStructures(const QList<TechnicalBulletin*>& bulletins)
+{
+    TRACE_SCOPE("Build index structures");
+    IndexStructures* Structures = new IndexStructures;
+    for (int i = 0; i < bulletins.count(); i++) {
+        Structures->Dictionary.addTB(i, bulletins.at(i));
+        Structures->Chains.addTB(i, bulletins.at(i), QHash<QString, qint32>());
+    }
+    Structures->Dates.build(bulletins);
+    return Structures;
+}
+
+//  installStructures
+//
+// Executed in the GUI thread, after the last chunk was appended: use the structures built by the loading thread
+//
+void ThreadIndex::installStructures(IndexStructures* structures)
+{
+    TRACE_SCOPE("Install index structures");
+    std::swap(this->Dictionary, structures->Dictionary);
+    std::swap(this->Dates, structures->Dates);
+    std::swap(this->Chains, structures->Chains);
+    this->Chains.updateMissing(this->Numbers);
+    delete structures;
+
+    this->Indexed = true;
+    this->Generation++;
+}
+
 //  readIndexV0
 //
 // Open an index in the legacy format
 //
 bool ThreadIndex::readIndexV0(int count, QDataStream& stream, bool ForceIndexCheck)
 {
+    TRACE_SCOPE("Read index V0");
     for (int i = 0; i < count; i++) {
         // Emit a message intended to a progress bar
         if (i % 100 == 0) {
@@ -154,8 +259,8 @@ bool ThreadIndex::readIndexV0(int count, QDataStream& stream, bool ForceIndexChe
             return false;
         }
 
-        // Add the bulletin to the list
-        this->Bulletins << TB;
+        // Send the bulletin to the GUI thread. The structures are built once the whole file is read
+        publishTB(TB);
     }
 
     // Success
@@ -167,6 +272,7 @@ bool ThreadIndex::readIndexV0(int count, QDataStream& stream, bool ForceIndexChe
 // Open an index version 1
 bool ThreadIndex::readIndexV1(qint32 count, QDataStream& stream, bool ForceIndexCheck)
 {
+    TRACE_SCOPE("Read index V1");
     for (int i = 0; i < count; i++) {
         // Emit a message intended for a progress bar
         if (i % 100 == 0) {
@@ -183,23 +289,362 @@ bool ThreadIndex::readIndexV1(qint32 count, QDataStream& stream, bool ForceIndex
             return false;
         }
 
-        // Add the bulletin to the list
-        this->Bulletins << TB;
+        // Send the bulletin to the GUI thread. The structures are built once the whole file is read
+        publishTB(TB);
     }
 
     // Success
     return true;
 }
 
+//  tbList
+//
+// Return the list of the TB. The position of a TB in the list is its id.
+// Removed TB are nullptr
+//
 QList<TechnicalBulletin*> ThreadIndex::tbList() const
 {
     return this->Bulletins;
 }
 
+TechnicalBulletin* ThreadIndex::tb(qint32 id) const
+{
+    return (id >= 0) && (id < this->Bulletins.count()) ? this->Bulletins.at(id) : nullptr;
+}
+
+//  addTB
+//
+// Add a TB to the index, which takes its ownership. Return the id of the TB
+//
+qint32 ThreadIndex::addTB(TechnicalBulletin* tb)
+{
+    qint32 Id = this->Bulletins.count();
+    this->Bulletins << tb;
+    this->Store << QSharedPointer<TechnicalBulletin>(tb);
+    addNumber(Id, tb);
+    this->Dictionary.addTB(Id, tb);
+    this->Dates.addTB(Id, tb);
+    this->Chains.addTB(Id, tb, this->Numbers);
+    this->Modified = true;
+    this->Generation++;
+    return Id;
+}
+
+//  addTBs
+//
+// Add several TB at once, eg. after a bulk import. Their ids follow each other.
+// The index is modified only once, so the cached searches and highlights are discarded only once
+//
+void ThreadIndex::addTBs(const QList<TechnicalBulletin*>& bulletins)
+{
+    TRACE_SCOPE("Add TB batch");
+    if (bulletins.isEmpty()) {
+        return;
+    }
+
+    // The ids are increasing, so the words are appended to the postings of the dictionary
+    this->Bulletins.reserve(this->Bulletins.count() + bulletins.count());
+    this->Store.reserve(this->Store.count() + bulletins.count());
+    this->Numbers.reserve(this->Numbers.count() + bulletins.count());
+    for (int i = 0; i < bulletins.count(); i++) {
+        TechnicalBulletin* TB = bulletins.at(i);
+        qint32             Id = this->Bulletins.count();
+        this->Bulletins << TB;
+        this->Store << QSharedPointer<TechnicalBulletin>(TB);
+        addNumber(Id, TB);
+        this->Dictionary.addTB(Id, TB);
+        this->Dates.addTB(Id, TB);
+        this->Chains.addTB(Id, TB, this->Numbers);
+    }
+    this->Modified = true;
+    this->Generation++;
+}
+
+//  updateTB
+//
+// Replace the data of an existing TB. The words of the old data are unregistered first.
+// The TB is replaced by a new one, because the old one may be read by a snapshot
+//
+void ThreadIndex::updateTB(qint32 id, const TechnicalBulletin& data)
+{
+    TechnicalBulletin* TB = tb(id);
+    if (TB != nullptr) {
+        removeNumber(id, TB);
+        this->Dictionary.removeTB(id, TB);
+        this->Dates.removeTB(id, TB);
+        this->Chains.removeTB(id, TB, this->Numbers);
+
+        // The data may belong to the old TB, which is released last
+        QSharedPointer<TechnicalBulletin> Old = this->Store.at(id);
+        this->Store[id]                       = QSharedPointer<TechnicalBulletin>::create(data);
+        this->Bulletins[id]                   = this->Store.at(id).data();
+        TB                                    = this->Bulletins.at(id);
+
+        addNumber(id, TB);
+        this->Dictionary.addTB(id, TB);
+        this->Dates.addTB(id, TB);
+        this->Chains.addTB(id, TB, this->Numbers);
+        this->Modified = true;
+        this->Generation++;
+    }
+}
+
+//  removeTB
+//
+// Delete a TB. Its slot is kept empty, so the ids of the other TB don't change.
+// The TB is destroyed once no snapshot reads it anymore
+//
+void ThreadIndex::removeTB(qint32 id)
+{
+    TechnicalBulletin* TB = tb(id);
+    if (TB != nullptr) {
+        removeNumber(id, TB);
+        this->Dictionary.removeTB(id, TB);
+        this->Dates.removeTB(id, TB);
+        this->Chains.removeTB(id, TB, this->Numbers);
+        this->Bulletins[id] = nullptr;
+        this->Store[id].reset();
+        this->Modified = true;
+        this->Generation++;
+    }
+}
+
+//  findTB
+//
+// Return the id of the TB having a number, or INVALID_TB_ID
+//
+qint32 ThreadIndex::findTB(const QString& number) const
+{
+    QString Number = normalizeNumber(number);
+    return Number.isEmpty() ? INVALID_TB_ID : this->Numbers.value(Number, INVALID_TB_ID);
+}
+
+//  addNumber
+//
+// Register the number of a TB. If the index contains duplicates, the first TB is kept
+//
+void ThreadIndex::addNumber(qint32 id, const TechnicalBulletin* tb)
+{
+    QString Number = normalizeNumber(tb->number());
+    if (!Number.isEmpty() && !this->Numbers.contains(Number)) {
+        this->Numbers.insert(Number, id);
+    }
+}
+
+//  removeNumber
+//
+// Unregister the number of a TB, if it is the one registered for this number
+//
+void ThreadIndex::removeNumber(qint32 id, const TechnicalBulletin* tb)
+{
+    QString Number = normalizeNumber(tb->number());
+    if (this->Numbers.value(Number, INVALID_TB_ID) == id) {
+        this->Numbers.remove(Number);
+    }
+}
+
+//  latestVersion
+//
+// Return the number of the latest known version of a TB
+//
+QString ThreadIndex::latestVersion(const QString& number) const
+{
+    return this->Chains.latestVersion(number);
+}
+
+//  history
+//
+// Return the numbers of all the versions of a TB, from the oldest to the latest
+//
+QStringList ThreadIndex::history(const QString& number) const
+{
+    return this->Chains.history(number);
+}
+
+//  brokenChains
+//
+// Return the ids of the TB replacing or replaced by a TB which is not in the index
+//
+QList<qint32> ThreadIndex::brokenChains() const
+{
+    return this->Chains.brokenChains();
+}
+
+//  obsoleteTB
+//
+// Return the pairs (obsolete TB id, latest version id) of the TB replaced by a more recent one present in the index
+//
+QList<QPair<qint32, qint32>> ThreadIndex::obsoleteTB() const
+{
+    return this->Chains.obsoleteTB(this->Bulletins, this->Numbers);
+}
+
+//  hasObsoleteVersion
+//
+// Return true if an older version of a TB is present in the index, and replaced by a more recent one.
+// Only the chain of the TB is read
+//
+bool ThreadIndex::hasObsoleteVersion(const QString& number) const
+{
+    QStringList History = history(number);
+    int         Latest  = static_cast<int>(History.count()) - 1;
+    while ((Latest >= 0) && !this->Numbers.contains(History.at(Latest))) {
+        Latest--;
+    }
+    for (int i = 0; i < Latest; i++) {
+        if (this->Numbers.contains(History.at(i))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//  resolveObsoleteTB
+//
+// Remove all the obsolete TB, after having merged their keywords into their latest version.
+// The keywords are gathered first, so each latest version is updated only once. Return the number of removed TB
+//
+int ThreadIndex::resolveObsoleteTB()
+{
+    QList<QPair<qint32, qint32>> Obsolete = obsoleteTB();
+    QHash<qint32, QStringList>   Merged;
+
+    for (int i = 0; i < Obsolete.count(); i++) {
+        qint32       LatestId = Obsolete.at(i).second;
+        QStringList& Keywords = Merged[LatestId];
+        if (Keywords.isEmpty()) {
+            Keywords = tb(LatestId)->keywords();
+        }
+
+        QStringList OldKeywords = tb(Obsolete.at(i).first)->keywords();
+        for (int j = 0; j < OldKeywords.count(); j++) {
+            if (!Keywords.contains(OldKeywords.at(j))) {
+                Keywords << OldKeywords.at(j);
+            }
+        }
+    }
+
+    for (auto Entry = Merged.constBegin(); Entry != Merged.constEnd(); ++Entry) {
+        TechnicalBulletin Data = *tb(Entry.key());
+        Data.setKeywords(Entry.value());
+        updateTB(Entry.key(), Data);
+    }
+
+    for (int i = 0; i < Obsolete.count(); i++) {
+        removeTB(Obsolete.at(i).first);
+    }
+
+    return Obsolete.count();
+}
+
+//  suggestions
+//
+// Return the most frequent words beginning with a prefix, in the given fields
+//
+QStringList ThreadIndex::suggestions(const QString& prefix, quint32 fields, int count) const
+{
+    return this->Dictionary.suggestions(prefix, fields, count);
+}
+
+//  save
+//
+// Write the index in the current format (see run() for the layout). The empty slots are not saved,
+// so the ids change at the next opening, not during this session
+//
 void ThreadIndex::save(bool backup)
 {
-    // TODO: save
+    TRACE_SCOPE("Save index");
+    // Keep a copy of the previous file, in the same directory
+    if (backup && QFileInfo::exists(this->FileName)) {
+        QString Backup = QFileInfo(this->FileName).dir().filePath(TBI_BACKUP_FILENAME);
+        QFile::remove(Backup);
+        if (!QFile::copy(this->FileName, Backup)) {
+            emit saveComplete(BACKUP_FAILED);
+            return;
+        }
+    }
+
+    // The file is replaced only once it is completely written
+    QSaveFile File(this->FileName);
+    if (!File.open(QIODevice::WriteOnly)) {
+        emit saveComplete(SAVE_COULD_NOT_OPEN_FILE);
+        return;
+    }
+
+    qint32 Count = static_cast<qint32>(this->Bulletins.count() - this->Bulletins.count(nullptr));
+    QDataStream Stream(&File);
+    Stream << qint32(0) << QString(TBI_MAGIC) << qint32(CURRENT_TBI_VERSION) << Count;
+    for (int i = 0; i < this->Bulletins.count(); i++) {
+        if (this->Bulletins.at(i) != nullptr) {
+            Stream << *this->Bulletins.at(i);
+        }
+    }
+
+    if ((Stream.status() != QDataStream::Ok) || !File.commit()) {
+        emit saveComplete(SAVE_FAILED);
+        return;
+    }
 
     this->Modified = false;
     emit saveComplete(SAVE_SUCCESSFUL);
 }
+
+//  search
+//
+// Return the TB matching a query, as a bit array indexed by TB id
+//
+QBitArray ThreadIndex::search(const QString& query, quint32 fields, bool wholeWords) const
+{
+    return this->Engine.search(query, fields, wholeWords);
+}
+
+//  memoryReport
+//
+// Account the memory used by the TB, then by each index structure
+//
+MemoryReport ThreadIndex::memoryReport() const
+{
+    MemoryReport Report;
+    qint64       Count = 0;
+    for (int i = 0; i < this->Bulletins.count(); i++) {
+        if (this->Bulletins.at(i) != nullptr) {
+            Report.addTB(this->Bulletins.at(i));
+            Count++;
+        }
+    }
+
+    // The normalized numbers usually share the storage of the TB numbers
+    qint64 Numbers = MemoryReport::hashBytes(this->Numbers.count(), this->Numbers.capacity(), sizeof(QString) + sizeof(qint32));
+    for (auto Number = this->Numbers.constBegin(); Number != this->Numbers.constEnd(); ++Number) {
+        Numbers += Report.newStringBytes(Number.key());
+    }
+
+    Report.addSubsystem("TB objects", Count * static_cast<qint64>(sizeof(TechnicalBulletin)));
+    Report.addSubsystem("TB store", MemoryReport::arrayBytes(this->Bulletins.capacity(), sizeof(TechnicalBulletin*)) + MemoryReport::arrayBytes(this->Store.capacity(), sizeof(QSharedPointer<TechnicalBulletin>)));
+    Report.addSubsystem("Number index", Numbers);
+    Report.addSubsystem(QString("Term dictionary (%1 words)").arg(this->Dictionary.termCount()), this->Dictionary.memoryUsage());
+    Report.addSubsystem("Date index", this->Dates.memoryUsage());
+    Report.addSubsystem("Supersession chains", this->Chains.memoryUsage());
+    Report.addSubsystem("Search cache", this->Engine.memoryUsage());
+    return Report;
+}
+
+//  snapshot
+//
+// Create a read-only copy of the index. The TB are shared with the index, which replaces them instead of
+// modifying them, so no TB is copied
+//
+IndexSnapshot* ThreadIndex::snapshot() const
+{
+    return new IndexSnapshot(this->Store, this->Numbers, this->Dictionary, this->Dates, this->Generation, this->Indexed);
+}
+
+//  matchSpans
+//
+// Return the parts of the fields of a TB matching a query
+//
+QList<MatchSpan> ThreadIndex::matchSpans(qint32 id, const QString& query, quint32 fields, bool wholeWords) const
+{
+    const TechnicalBulletin* TB = tb(id);
+    return TB != nullptr ? this->Engine.matchSpans(TB, query, fields, wholeWords) : QList<MatchSpan>();
+}
@@ -22,22 +22,87 @@
 #ifndef THREADINDEX_HPP
 #define THREADINDEX_HPP
 
+#include "DateIndex.hpp"
+#include "MemoryReport.hpp"
+#include "SearchEngine.hpp"
+#include "SupersessionGraph.hpp"
 #include "TechnicalBulletin.hpp"
+#include "TermDictionary.hpp"
+#include <QBitArray>
+#include <QHash>
 #include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <QSharedPointer>
 #include <QThread>
 
-// Need a MainWindow ptr, but can't include MainWindow header
-class MainWindow;
+class IndexSnapshot;
+
+//  IndexStructures
+//
+// Search structures built by the loading thread, then installed in the GUI thread
+//
+struct IndexStructures
+{
+    TermDictionary    Dictionary;
+    DateIndex         Dates;
+    SupersessionGraph Chains;
+};
+Q_DECLARE_METATYPE(IndexStructures*)
 
 class ThreadIndex: public QThread
 {
     Q_OBJECT
 
   public:
-    ThreadIndex(MainWindow* MainWindowPtr, bool ForceIndexCheck);
+    ThreadIndex(bool ForceIndexCheck, const QString& FileName);
     ~ThreadIndex();
 
+    QString fileName() const { return this->FileName; }
+
     QList<TechnicalBulletin*> tbList() const;
+    TechnicalBulletin*        tb(qint32 id) const;
+
+    // Index modifications. The TB ids are stable: a removed TB leaves an empty slot
+    qint32 addTB(TechnicalBulletin* tb);
+    void   addTBs(const QList<TechnicalBulletin*>& bulletins);
+    void   updateTB(qint32 id, const TechnicalBulletin& data);
+    void   removeTB(qint32 id);
+
+    // Number index
+    qint32         findTB(const QString& number) const;
+    static QString normalizeNumber(const QString& number) { return number.trimmed().toUpper(); }
+
+    // Supersession chains
+    QString                      latestVersion(const QString& number) const;
+    QStringList                  history(const QString& number) const;
+    QList<qint32>                brokenChains() const;
+    QList<QPair<qint32, qint32>> obsoleteTB() const;
+    bool                         hasObsoleteVersion(const QString& number) const;
+    int                          resolveObsoleteTB();
+
+    // Term dictionary
+    QStringList suggestions(const QString& prefix, quint32 fields, int count) const;
+
+    // Search
+    QBitArray        search(const QString& query, quint32 fields, bool wholeWords) const;
+    QList<MatchSpan> matchSpans(qint32 id, const QString& query, quint32 fields, bool wholeWords) const;
+
+    // Memory accounting of the TB and of the index structures
+    MemoryReport memoryReport() const;
+
+    // Read-only copy of the index, which can be shared with other threads
+    IndexSnapshot* snapshot() const;
+
+    // Incremented each time the index is modified
+    quint64 generation() const { return this->Generation; }
+    bool    isModified() const { return this->Modified; }
+    bool    isIndexed() const { return this->Indexed; }
+
+    // Save the index in its file, the result is sent with saveComplete()
+    void save(bool backup);
 
   signals:
     // Normal opening
@@ -55,21 +120,44 @@ class ThreadIndex: public QThread
     // End of opening (with or withour error)
     void openingComplete();
 
+    // Progressive loading: count TB are available in the GUI thread
+    void tbAvailable(int count);
+
+    // Internal: data sent by the loading thread to the GUI thread
+    void chunkLoaded(QList<TechnicalBulletin*> chunk);
+    void structuresBuilt(IndexStructures* structures);
+
     // Save
     void saveComplete(int result);
 
   private:
-    MainWindow*               MainWindowPtr;
-    bool                      ForceIndexCheck;
-    bool                      Modified;
-    QList<TechnicalBulletin*> Bulletins;
-
-    void run() override;
-    bool readIndexV0(int count, QDataStream& stream, bool ForceIndexCheck);
-    bool readIndexV1(qint32 Count, QDataStream& stream, bool ForceIndexCheck);
-
-    // Slots triggered by MainWindow
-    void save(bool backup);
+    bool                                     ForceIndexCheck;
+    QString                                  FileName;
+    bool                                     Modified;
+    quint64                                  Generation;
+    bool                                     Indexed;
+    QList<TechnicalBulletin*>                Bulletins;
+    QList<QSharedPointer<TechnicalBulletin>> Store; // Owns the TB. A TB is replaced instead of being modified, so the snapshots can share it
+    QHash<QString, qint32>                   Numbers;
+    TermDictionary                           Dictionary;
+    DateIndex                                Dates;
+    SupersessionGraph                        Chains;
+    SearchEngine                             Engine;
+
+    // Loading, see publishTB()
+    QList<TechnicalBulletin*> Loaded;  // Used only by the loading thread
+    QList<TechnicalBulletin*> Pending; // Used only by the loading thread
+
+    void                    run() override;
+    void                    publishTB(TechnicalBulletin* tb);
+    void                    flushTB();
+    void                    appendChunk(const QList<TechnicalBulletin*>& chunk);
+    static IndexStructures* buildStructures(const QList<TechnicalBulletin*>& bulletins);
+    void                    installStructures(IndexStructures* structures);
+    void                    addNumber(qint32 id, const TechnicalBulletin* tb);
+    void                    removeNumber(qint32 id, const TechnicalBulletin* tb);
+    bool                    readIndexV0(int count, QDataStream& stream, bool ForceIndexCheck);
+    bool                    readIndexV1(qint32 Count, QDataStream& stream, bool ForceIndexCheck);
 };
 
 // Index filename
@@ -86,6 +174,13 @@ class ThreadIndex: public QThread
 #define BACKUP_ON_SAVE    true
 #define NO_BACKUP_ON_SAVE false
 
+// Progressive loading: size of the first chunk sent to the GUI (about a screenful), then of the next ones
+#define FIRST_CHUNK_SIZE 64
+#define LOAD_CHUNK_SIZE  1024
+
+// Id returned when a TB is not found
+#define INVALID_TB_ID -1
+
 // Save results
 #define SAVE_SUCCESSFUL          0
 #define BACKUP_FAILED            1
@@ -21,6 +21,7 @@
 
 #include "Settings.hpp"
 #include "Global.hpp"
+#include <QtConcurrent>
 
 Settings::Settings(QString organization, QString application)
     : QSettings(organization, application)
@@ -28,10 +29,117 @@ Settings::Settings(QString organization, QString application)
     // Remove some old keys to clean up the Windows Registry
     remove("baseUrlTechPub");
     remove("baseUrlRM");
+
+    // Writes are performed one after the other
+    this->Writer.setMaxThreadCount(1);
+    load();
 }
 
 Settings::~Settings()
 {
+    // Don't lose pending writes
+    this->Writer.waitForDone();
+}
+
+//  load
+//
+// Read all the settings from QSettings. This is the only place where values are read from the backend
+//
+void Settings::load()
+{
+    this->Snapshot.BaseURLTechnicalBulletinWebpage = value(KEY_BASE_URL_TB_WEBPAGE, DEFAULT_BASE_URL_TB_WEBPAGE).toString();
+    this->Snapshot.BaseURLTechnicalBulletinPDF     = value(KEY_BASE_URL_TB_PDF, DEFAULT_BASE_URL_TB_PDF).toString();
+    this->Snapshot.BaseURLTechnicalPublications    = value(KEY_BASE_URL_TECH_PUBS, DEFAULT_BASE_URL_TECH_PUBS).toString();
+    this->Snapshot.RealTimeSearch                  = value(KEY_REAL_TIME_SEARCH, DEFAULT_REAL_TIME_SEARCH).toBool();
+    this->Snapshot.WholeWordsOnly                  = value(KEY_WHOLE_WORDS_ONLY, DEFAULT_WHOLE_WORDS_ONLY).toBool();
+    this->Snapshot.Categories                      = value(KEY_CATEGORY_LIST).toStringList();
+    this->Snapshot.MainWindowSize                  = value(KEY_MAIN_WINDOW_SIZE, DEFAULT_MAIN_WINDOW_SIZE).toSize();
+    this->Snapshot.SearchNumber                    = value(KEY_SEARCH_NUMBER, DEFAULT_SEARCH_NUMBER).toBool();
+    this->Snapshot.SearchTitle                     = value(KEY_SEARCH_TITLE, DEFAULT_SEARCH_TITLE).toBool();
+    this->Snapshot.SearchCategory                  = value(KEY_SEARCH_CATEGORY, DEFAULT_SEARCH_CATEGORY).toBool();
+    this->Snapshot.SearchRK                        = value(KEY_SEARCH_RK, DEFAULT_SEARCH_RK).toBool();
+    this->Snapshot.SearchTechPub                   = value(KEY_SEARCH_TECH_PUB, DEFAULT_SEARCH_TECH_PUB).toBool();
+    this->Snapshot.SearchReleaseDate               = value(KEY_SEARCH_RELEASE_DATE, DEFAULT_SEARCH_RELEASE_DATE).toBool();
+    this->Snapshot.SearchRegisteredBy              = value(KEY_SEARCH_REGISTERED_BY, DEFAULT_SEARCH_REGISTERED_BY).toBool();
+    this->Snapshot.SearchReplaces                  = value(KEY_SEARCH_REPLACES, DEFAULT_SEARCH_REPLACES).toBool();
+    this->Snapshot.SearchReplacedBy                = value(KEY_SEARCH_REPLACED_BY, DEFAULT_SEARCH_REPLACED_BY).toBool();
+    this->Snapshot.SearchComment                   = value(KEY_SEARCH_COMMENT, DEFAULT_SEARCH_COMMENT).toBool();
+    this->Snapshot.FirstRun                        = value(KEY_FIRST_RUN, DEFAULT_FIRST_RUN).toBool();
+    this->Snapshot.InboxDirectory                  = value(KEY_INBOX_DIRECTORY, DEFAULT_INBOX_DIRECTORY).toString();
+}
+
+//  write
+//
+// Write a copy of the snapshot back to QSettings, in the writer thread.
+// QSettings is reentrant, so the worker uses its own instance
+//
+void Settings::write()
+{
+    SettingsSnapshot Copy         = this->Snapshot;
+    QString          Organization = organizationName();
+    QString          Application  = applicationName();
+
+    QtConcurrent::run(&this->Writer, [Copy, Organization, Application]() {
+        QSettings Backend(Organization, Application);
+        Backend.setValue(KEY_BASE_URL_TB_WEBPAGE, Copy.BaseURLTechnicalBulletinWebpage);
+        Backend.setValue(KEY_BASE_URL_TB_PDF, Copy.BaseURLTechnicalBulletinPDF);
+        Backend.setValue(KEY_BASE_URL_TECH_PUBS, Copy.BaseURLTechnicalPublications);
+        Backend.setValue(KEY_REAL_TIME_SEARCH, Copy.RealTimeSearch);
+        Backend.setValue(KEY_WHOLE_WORDS_ONLY, Copy.WholeWordsOnly);
+        Backend.setValue(KEY_MAIN_WINDOW_SIZE, Copy.MainWindowSize);
+        Backend.setValue(KEY_SEARCH_NUMBER, Copy.SearchNumber);
+        Backend.setValue(KEY_SEARCH_TITLE, Copy.SearchTitle);
+        Backend.setValue(KEY_SEARCH_CATEGORY, Copy.SearchCategory);
+        Backend.setValue(KEY_SEARCH_RK, Copy.SearchRK);
+        Backend.setValue(KEY_SEARCH_TECH_PUB, Copy.SearchTechPub);
+        Backend.setValue(KEY_SEARCH_RELEASE_DATE, Copy.SearchReleaseDate);
+        Backend.setValue(KEY_SEARCH_REGISTERED_BY, Copy.SearchRegisteredBy);
+        Backend.setValue(KEY_SEARCH_REPLACES, Copy.SearchReplaces);
+        Backend.setValue(KEY_SEARCH_REPLACED_BY, Copy.SearchReplacedBy);
+        Backend.setValue(KEY_SEARCH_COMMENT, Copy.SearchComment);
+        Backend.setValue(KEY_FIRST_RUN, Copy.FirstRun);
+        Backend.setValue(KEY_INBOX_DIRECTORY, Copy.InboxDirectory);
+
+        // An empty category list is removed from the backend
+        if (Copy.Categories.isEmpty()) {
+            Backend.remove(KEY_CATEGORY_LIST);
+        }
+        else {
+            Backend.setValue(KEY_CATEGORY_LIST, Copy.Categories);
+        }
+    });
+}
+
+//  setSnapshot
+//
+// Replace all the settings at once, then notify the subscribers
+//
+void Settings::setSnapshot(const SettingsSnapshot& snapshot)
+{
+    this->Snapshot = snapshot;
+    this->Snapshot.Categories.sort(Qt::CaseInsensitive);
+    write();
+    emit snapshotChanged(this->Snapshot);
+}
+
+//  searchFields
+//
+// Return the mask of the fields used by the search. Keywords are always searched
+//
+quint32 SettingsSnapshot::searchFields() const
+{
+    quint32 Fields = FIELD_MASK(FIELD_KEYWORDS);
+    Fields |= this->SearchNumber ? FIELD_MASK(FIELD_NUMBER) : 0;
+    Fields |= this->SearchTitle ? FIELD_MASK(FIELD_TITLE) : 0;
+    Fields |= this->SearchCategory ? FIELD_MASK(FIELD_CATEGORY) : 0;
+    Fields |= this->SearchRK ? FIELD_MASK(FIELD_RK) : 0;
+    Fields |= this->SearchTechPub ? FIELD_MASK(FIELD_TECH_PUB) : 0;
+    Fields |= this->SearchReleaseDate ? FIELD_MASK(FIELD_RELEASE_DATE) : 0;
+    Fields |= this->SearchRegisteredBy ? FIELD_MASK(FIELD_REGISTERED_BY) : 0;
+    Fields |= this->SearchReplaces ? FIELD_MASK(FIELD_REPLACES) : 0;
+    Fields |= this->SearchReplacedBy ? FIELD_MASK(FIELD_REPLACED_BY) : 0;
+    Fields |= this->SearchComment ? FIELD_MASK(FIELD_COMMENT) : 0;
+    return Fields;
 }
 
 // Singleton stuff
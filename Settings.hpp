@@ -22,11 +22,13 @@
 #ifndef SETTINGS_HPP
 #define SETTINGS_HPP
 
+#include "Index/TechnicalBulletin.hpp"
 #include <Global.hpp>
 #include <QSettings>
 #include <QSize>
 #include <QString>
 #include <QStringList>
+#include <QThreadPool>
 
 // Key names
 #define KEY_BASE_URL_TB_WEBPAGE  "baseUrlTBwebpage"
@@ -47,6 +49,7 @@
 #define KEY_SEARCH_REPLACED_BY   "searchReplacedBy"
 #define KEY_SEARCH_COMMENT       "searchComment"
 #define KEY_FIRST_RUN            "firstRun"
+#define KEY_INBOX_DIRECTORY      "inboxDirectory"
 
 // Default values
 #define DEFAULT_BASE_URL_TB_WEBPAGE  "https://piv.tetrapak.com/techbull/detail_techbull.aspx?id=%1"
@@ -66,83 +69,142 @@
 #define DEFAULT_SEARCH_REPLACED_BY   false
 #define DEFAULT_SEARCH_COMMENT       false
 #define DEFAULT_FIRST_RUN            true
+#define DEFAULT_INBOX_DIRECTORY      ""
+
+//  SettingsSnapshot
+//
+// Plain copy of all the settings.
+// It is loaded once at startup, so reading a setting never hits the QSettings backend (the Windows Registry)
+//
+struct SettingsSnapshot
+{
+    QString     BaseURLTechnicalBulletinWebpage;
+    QString     BaseURLTechnicalBulletinPDF;
+    QString     BaseURLTechnicalPublications;
+    bool        RealTimeSearch;
+    bool        WholeWordsOnly;
+    QStringList Categories;
+    QSize       MainWindowSize;
+    bool        SearchNumber;
+    bool        SearchTitle;
+    bool        SearchCategory;
+    bool        SearchRK;
+    bool        SearchTechPub;
+    bool        SearchReleaseDate;
+    bool        SearchRegisteredBy;
+    bool        SearchReplaces;
+    bool        SearchReplacedBy;
+    bool        SearchComment;
+    bool        FirstRun;
+    QString     InboxDirectory; // Watched for new mails, disabled if empty
+
+    quint32 searchFields() const;
+};
 
 //  Settings
 //
 // This class handles the global configuration of the software
+// Getters read the snapshot, setters update it then write it back to QSettings in a worker thread.
+// A whole new snapshot (ie. the settings dialog was accepted) is published with snapshotChanged()
 //
 class Settings: public QSettings
 {
+    Q_OBJECT
+
   public:
     static Settings* instance();
     static void      release();
 
-    QString baseURLTechnicalBulletinWebpage() { return value(KEY_BASE_URL_TB_WEBPAGE, DEFAULT_BASE_URL_TB_WEBPAGE).toString(); }
-    void    setBaseURLTechnicalBulletinWepbage(QString url) { setValue(KEY_BASE_URL_TB_WEBPAGE, url); }
-    void    resetBaseURLTechnicalBulletinWebpage() { setValue(KEY_BASE_URL_TB_WEBPAGE, DEFAULT_BASE_URL_TB_WEBPAGE); }
+    const SettingsSnapshot& snapshot() const { return this->Snapshot; }
+    void                    setSnapshot(const SettingsSnapshot& snapshot);
+
+    QString baseURLTechnicalBulletinWebpage() const { return this->Snapshot.BaseURLTechnicalBulletinWebpage; }
+    void    setBaseURLTechnicalBulletinWepbage(QString url) { update(this->Snapshot.BaseURLTechnicalBulletinWebpage, url); }
+    void    resetBaseURLTechnicalBulletinWebpage() { update(this->Snapshot.BaseURLTechnicalBulletinWebpage, QString(DEFAULT_BASE_URL_TB_WEBPAGE)); }
 
-    QString baseURLTechnicalBulletinPDF() { return value(KEY_BASE_URL_TB_PDF, DEFAULT_BASE_URL_TB_PDF).toString(); }
-    void    setBaseURLTechnicalBulletinPDF(QString url) { setValue(KEY_BASE_URL_TB_PDF, url); }
-    void    resetBaseURLTechnicalBulletinPDF() { setValue(KEY_BASE_URL_TB_PDF, DEFAULT_BASE_URL_TB_PDF); }
+    QString baseURLTechnicalBulletinPDF() const { return this->Snapshot.BaseURLTechnicalBulletinPDF; }
+    void    setBaseURLTechnicalBulletinPDF(QString url) { update(this->Snapshot.BaseURLTechnicalBulletinPDF, url); }
+    void    resetBaseURLTechnicalBulletinPDF() { update(this->Snapshot.BaseURLTechnicalBulletinPDF, QString(DEFAULT_BASE_URL_TB_PDF)); }
 
-    QString baseURLTechnicalPublications() { return value(KEY_BASE_URL_TECH_PUBS, DEFAULT_BASE_URL_TECH_PUBS).toString(); }
-    void    setBaseURLTechnicalPublications(QString url) { setValue(KEY_BASE_URL_TECH_PUBS, url); }
-    void    resetBaseURLTechnicalPublications() { setValue(KEY_BASE_URL_TECH_PUBS, DEFAULT_BASE_URL_TECH_PUBS); }
+    QString baseURLTechnicalPublications() const { return this->Snapshot.BaseURLTechnicalPublications; }
+    void    setBaseURLTechnicalPublications(QString url) { update(this->Snapshot.BaseURLTechnicalPublications, url); }
+    void    resetBaseURLTechnicalPublications() { update(this->Snapshot.BaseURLTechnicalPublications, QString(DEFAULT_BASE_URL_TECH_PUBS)); }
 
-    bool realTimeSearchEnabled() { return value(KEY_REAL_TIME_SEARCH, DEFAULT_REAL_TIME_SEARCH).toBool(); }
-    void setRealTimeSearchEnabled(bool enabled) { setValue(KEY_REAL_TIME_SEARCH, enabled); }
+    bool realTimeSearchEnabled() const { return this->Snapshot.RealTimeSearch; }
+    void setRealTimeSearchEnabled(bool enabled) { update(this->Snapshot.RealTimeSearch, enabled); }
 
-    bool wholeWordsOnlyEnabled() { return value(KEY_WHOLE_WORDS_ONLY, DEFAULT_WHOLE_WORDS_ONLY).toBool(); }
-    void setWholeWordsOnlyEnabled(bool enabled) { setValue(KEY_WHOLE_WORDS_ONLY, enabled); }
+    bool wholeWordsOnlyEnabled() const { return this->Snapshot.WholeWordsOnly; }
+    void setWholeWordsOnlyEnabled(bool enabled) { update(this->Snapshot.WholeWordsOnly, enabled); }
 
-    QStringList categories() { return value(KEY_CATEGORY_LIST).toStringList(); }
+    QStringList categories() const { return this->Snapshot.Categories; }
     void        setCategories(QStringList categories)
     {
         categories.sort(Qt::CaseInsensitive);
-        setValue(KEY_CATEGORY_LIST, categories);
+        update(this->Snapshot.Categories, categories);
     }
-    void resetCategories() { remove(KEY_CATEGORY_LIST); }
+    void resetCategories() { update(this->Snapshot.Categories, QStringList()); }
 
-    QSize mainWindowSize() { return value(KEY_MAIN_WINDOW_SIZE, DEFAULT_MAIN_WINDOW_SIZE).toSize(); }
-    void  setMainWindowSize(QSize size) { setValue(KEY_MAIN_WINDOW_SIZE, size); }
+    QSize mainWindowSize() const { return this->Snapshot.MainWindowSize; }
+    void  setMainWindowSize(QSize size) { update(this->Snapshot.MainWindowSize, size); }
 
-    bool searchNumberEnabled() { return value(KEY_SEARCH_NUMBER, DEFAULT_SEARCH_NUMBER).toBool(); }
-    void setSearchNumber(bool enabled) { setValue(KEY_SEARCH_NUMBER, enabled); }
+    bool searchNumberEnabled() const { return this->Snapshot.SearchNumber; }
+    void setSearchNumber(bool enabled) { update(this->Snapshot.SearchNumber, enabled); }
 
-    bool searchTitleEnabled() { return value(KEY_SEARCH_TITLE, DEFAULT_SEARCH_TITLE).toBool(); }
-    void setSearchTitle(bool enabled) { setValue(KEY_SEARCH_TITLE, enabled); }
+    bool searchTitleEnabled() const { return this->Snapshot.SearchTitle; }
+    void setSearchTitle(bool enabled) { update(this->Snapshot.SearchTitle, enabled); }
 
-    bool searchCategoryEnabled() { return value(KEY_SEARCH_CATEGORY, DEFAULT_SEARCH_CATEGORY).toBool(); }
-    void setSearchCategory(bool enabled) { setValue(KEY_SEARCH_CATEGORY, enabled); }
+    bool searchCategoryEnabled() const { return this->Snapshot.SearchCategory; }
+    void setSearchCategory(bool enabled) { update(this->Snapshot.SearchCategory, enabled); }
 
-    bool searchRKEnabled() { return value(KEY_SEARCH_RK, DEFAULT_SEARCH_RK).toBool(); }
-    void setSearchRK(bool enabled) { setValue(KEY_SEARCH_RK, enabled); }
+    bool searchRKEnabled() const { return this->Snapshot.SearchRK; }
+    void setSearchRK(bool enabled) { update(this->Snapshot.SearchRK, enabled); }
 
-    bool searchTechPubEnabled() { return value(KEY_SEARCH_TECH_PUB, DEFAULT_SEARCH_TECH_PUB).toBool(); }
-    void setSearchTechPub(bool enabled) { setValue(KEY_SEARCH_TECH_PUB, enabled); }
+    bool searchTechPubEnabled() const { return this->Snapshot.SearchTechPub; }
+    void setSearchTechPub(bool enabled) { update(this->Snapshot.SearchTechPub, enabled); }
 
-    bool searchReleaseDateEnabled() { return value(KEY_SEARCH_RELEASE_DATE, DEFAULT_SEARCH_RELEASE_DATE).toBool(); }
-    void setSearchReleaseDate(bool enabled) { setValue(KEY_SEARCH_RELEASE_DATE, enabled); }
+    bool searchReleaseDateEnabled() const { return this->Snapshot.SearchReleaseDate; }
+    void setSearchReleaseDate(bool enabled) { update(this->Snapshot.SearchReleaseDate, enabled); }
 
-    bool searchRegisteredByEnabled() { return value(KEY_SEARCH_REGISTERED_BY, DEFAULT_SEARCH_REGISTERED_BY).toBool(); }
-    void setSearchRegisteredBy(bool enabled) { setValue(KEY_SEARCH_REGISTERED_BY, enabled); }
+    bool searchRegisteredByEnabled() const { return this->Snapshot.SearchRegisteredBy; }
+    void setSearchRegisteredBy(bool enabled) { update(this->Snapshot.SearchRegisteredBy, enabled); }
 
-    bool searchReplacesEnabled() { return value(KEY_SEARCH_REPLACES, DEFAULT_SEARCH_REPLACES).toBool(); }
-    void setSearchReplaces(bool enabled) { setValue(KEY_SEARCH_REPLACES, enabled); }
+    bool searchReplacesEnabled() const { return this->Snapshot.SearchReplaces; }
+    void setSearchReplaces(bool enabled) { update(this->Snapshot.SearchReplaces, enabled); }
 
-    bool searchReplacedByEnabled() { return value(KEY_SEARCH_REPLACED_BY, DEFAULT_SEARCH_REPLACED_BY).toBool(); }
-    void setSearchReplacedBy(bool enabled) { setValue(KEY_SEARCH_REPLACED_BY, enabled); }
+    bool searchReplacedByEnabled() const { return this->Snapshot.SearchReplacedBy; }
+    void setSearchReplacedBy(bool enabled) { update(this->Snapshot.SearchReplacedBy, enabled); }
 
-    bool searchCommentEnabled() { return value(KEY_SEARCH_COMMENT, DEFAULT_SEARCH_COMMENT).toBool(); }
-    void setSearchComment(bool enabled) { setValue(KEY_SEARCH_COMMENT, enabled); }
+    bool searchCommentEnabled() const { return this->Snapshot.SearchComment; }
+    void setSearchComment(bool enabled) { update(this->Snapshot.SearchComment, enabled); }
 
-    bool firstRun() { return value(KEY_FIRST_RUN, DEFAULT_FIRST_RUN).toBool(); }
-    void firstRunDone() { setValue(KEY_FIRST_RUN, false); }
+    bool firstRun() const { return this->Snapshot.FirstRun; }
+    void firstRunDone() { update(this->Snapshot.FirstRun, false); }
+
+    QString inboxDirectory() const { return this->Snapshot.InboxDirectory; }
+    void    setInboxDirectory(QString directory) { update(this->Snapshot.InboxDirectory, directory); }
+
+  signals:
+    void snapshotChanged(const SettingsSnapshot& snapshot);
 
   private:
     static Settings* settings;
     Settings(QString organization, QString application);
     ~Settings();
+
+    SettingsSnapshot Snapshot;
+    QThreadPool      Writer; // Single thread, so the writes are performed in order
+
+    void load();
+    void write();
+
+    // Update a setting of the snapshot, then write it back if it changed
+    template<typename T> void update(T& setting, const T& value)
+    {
+        if (setting != value) {
+            setting = value;
+            write();
+        }
+    }
 };
 
 #endif // SETTINGS_HPP
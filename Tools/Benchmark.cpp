@@ -0,0 +1,538 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "Global.hpp"
+#include "Index/IndexService.hpp"
+#include "Index/TechnicalBulletin.hpp"
+#include "TBGenerator.hpp"
+#include "UI/TBTableModel.hpp"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#define BENCH_DEFAULT_SIZES      "1000,10000,100000"
+#define BENCH_DEFAULT_ITERATIONS 5
+#define BENCH_DEFAULT_SEED       20201
+#define BENCH_CASES              "parse,save,load,search,populate"
+
+// Regression check: relative slowdown tolerated, and absolute difference ignored as noise (ms)
+#define BENCH_DEFAULT_TOLERANCE 0.25
+#define BENCH_NOISE_FLOOR       0.05
+
+// Slowdown tolerated beyond a linear growth between two index sizes, see checkScaling()
+#define BENCH_SCALING_TOLERANCE 1.0
+
+// Exit codes of the regression check. The skip code is the one declared to CTest (SKIP_RETURN_CODE)
+#define BENCH_EXIT_REGRESSION 2
+#define BENCH_EXIT_SKIPPED    77
+
+// Queries measured, whole words then partial words
+static const char* WholeWordQueries[] = {"valve", "valve pump", "valve OR sealing", "valve -pump", "title:jaw", "(kit OR upgrade) safety"};
+static const char* PartialQueries[]   = {"val", "seal", "p12", "ation"};
+
+//  Benchmark
+//
+// Measure the hot paths of TBI on synthetic indexes of several sizes: mail parsing, save, load (readIndexV1),
+// whole word and partial searches, and table population.
+// Each measure is repeated, the min, median and mean durations are reported as JSON.
+// The medians can be compared to a baseline (a previous report), and to the medians at the smaller sizes, to detect the regressions
+//
+class Benchmark
+{
+  public:
+    Benchmark(quint32 seed, int iterations, const QString& directory, const QStringList& cases);
+    void        run(int size);
+    QJsonObject report() const;
+    int         compare(const QJsonObject& baseline, double tolerance, int* missing) const;
+    int         checkScaling(double tolerance, int* checked) const;
+    int         count() const { return static_cast<int>(this->Results.count()); }
+
+  private:
+    quint32     Seed;
+    int         Iterations;
+    QString     Directory;
+    QStringList Cases; // Measures to run, see BENCH_CASES
+    QJsonArray  Results;
+
+    bool isSelected(const char* name) const { return this->Cases.contains(name); }
+
+    QList<TechnicalBulletin*> generate(int count) const;
+    static QByteArray         mail(const TechnicalBulletin& tb);
+    void                      record(const QString& name, int size, const QList<double>& durations, double items);
+
+    void benchParse(const QList<TechnicalBulletin*>& bulletins);
+    void benchSave(IndexService& service, int size);
+    void benchLoad(const QString& fileName, int size, std::unique_ptr<IndexService>& service);
+    void benchSearch(IndexService& service, int size);
+    void benchPopulate(IndexService& service, int size);
+};
+
+Benchmark::Benchmark(quint32 seed, int iterations, const QString& directory, const QStringList& cases)
+    : Seed(seed)
+    , Iterations(iterations)
+    , Directory(directory)
+    , Cases(cases)
+{
+}
+
+//  run
+//
+// Run the selected measures at an index size.
+// The index is saved then reloaded even if these steps are not measured, because the next measures need it
+//
+void Benchmark::run(int size)
+{
+    QList<TechnicalBulletin*> Bulletins = generate(size);
+    if (isSelected("parse")) {
+        benchParse(Bulletins);
+    }
+    if (!isSelected("save") && !isSelected("load") && !isSelected("search") && !isSelected("populate")) {
+        qDeleteAll(Bulletins);
+        return;
+    }
+
+    // Save then reload the same index
+    QString FileName = QString("%1/index-%2.tbi").arg(this->Directory).arg(size);
+    {
+        IndexService Service(FileName);
+        Service.waitForOpened();
+        Service.addTBs(Bulletins);
+        if (isSelected("save")) {
+            benchSave(Service, size);
+        }
+        else {
+            Service.save(NO_BACKUP_ON_SAVE);
+        }
+    }
+    if (!isSelected("load") && !isSelected("search") && !isSelected("populate")) {
+        return;
+    }
+
+    std::unique_ptr<IndexService> Service;
+    if (isSelected("load")) {
+        benchLoad(FileName, size, Service);
+    }
+    else {
+        Service.reset(new IndexService(FileName));
+        Service->waitForOpened();
+    }
+    if (isSelected("search")) {
+        benchSearch(*Service, size);
+    }
+    if (isSelected("populate")) {
+        benchPopulate(*Service, size);
+    }
+}
+
+//  generate
+//
+// Create realistic TB. The generator is seeded, so two runs measure the same data
+//
+QList<TechnicalBulletin*> Benchmark::generate(int count) const
+{
+    TBGenerator               Generator(this->Seed + count);
+    QList<TechnicalBulletin*> Bulletins;
+    Bulletins.reserve(count);
+    for (int i = 0; i < count; i++) {
+        Bulletins << new TechnicalBulletin(Generator.next());
+    }
+    return Bulletins;
+}
+
+//  mail
+//
+// Return a subscription mail describing a TB, as parsed by TechnicalBulletin(QByteArray)
+//
+QByteArray Benchmark::mail(const TechnicalBulletin& tb)
+{
+    QString Text = QString("From: TB subscription\nSubject: New Technical Bulletin %1\n\n"
+                           "Bulletin No:\t%1\nTitle:\t%2\nTB Category:\t%3\nRebuilding Kit(s):\t%4\nTechnical Publication(s):\t%5\n"
+                           "Release date:\t%6\nRegistered by:\t%7\nReplaces:\t%8\nReplaced by:\t%9\nComments:\t%10\t\n")
+                       .arg(tb.number(), tb.title(), tb.category(), tb.rk(), tb.techpub(), tb.releaseDate().toString("yyyy-MM-dd"), tb.registeredBy(), tb.replaces(), tb.replacedBy())
+                       .arg(tb.comment());
+    return Text.toUtf8();
+}
+
+//  record
+//
+// Add the result of a measure. items is the number of items handled by one iteration, used to compute a throughput
+//
+void Benchmark::record(const QString& name, int size, const QList<double>& durations, double items)
+{
+    QList<double> Sorted = durations;
+    std::sort(Sorted.begin(), Sorted.end());
+
+    double Sum = 0;
+    for (int i = 0; i < Sorted.count(); i++) {
+        Sum += Sorted.at(i);
+    }
+    double Median = Sorted.at(Sorted.count() / 2);
+
+    QJsonObject Result;
+    Result.insert("name", name);
+    Result.insert("size", size);
+    Result.insert("iterations", Sorted.count());
+    Result.insert("min_ms", Sorted.first());
+    Result.insert("median_ms", Median);
+    Result.insert("mean_ms", Sum / Sorted.count());
+    Result.insert("items_per_second", Median > 0 ? items * 1000 / Median : 0);
+    this->Results.append(Result);
+
+    QTextStream(stderr) << QString("%1 [%2]: %3 ms\n").arg(name).arg(size).arg(Median, 0, 'f', 3);
+}
+
+//  benchParse
+//
+// Parse the mails of the TB
+//
+void Benchmark::benchParse(const QList<TechnicalBulletin*>& bulletins)
+{
+    QList<QByteArray> Mails;
+    Mails.reserve(bulletins.count());
+    for (int i = 0; i < bulletins.count(); i++) {
+        Mails << mail(*bulletins.at(i));
+    }
+
+    QList<double> Durations;
+    for (int Iteration = 0; Iteration < this->Iterations; Iteration++) {
+        QElapsedTimer Timer;
+        Timer.start();
+        for (int i = 0; i < Mails.count(); i++) {
+            TechnicalBulletin TB(Mails.at(i));
+            Q_UNUSED(TB)
+        }
+        Durations << Timer.nsecsElapsed() / 1e6;
+    }
+    record("parse", bulletins.count(), Durations, bulletins.count());
+}
+
+//  benchSave
+//
+void Benchmark::benchSave(IndexService& service, int size)
+{
+    QList<double> Durations;
+    for (int Iteration = 0; Iteration < this->Iterations; Iteration++) {
+        QElapsedTimer Timer;
+        Timer.start();
+        service.save(NO_BACKUP_ON_SAVE);
+        Durations << Timer.nsecsElapsed() / 1e6;
+    }
+    record("save", size, Durations, size);
+}
+
+//  benchLoad
+//
+// Open the index file, until the search structures are installed. The last index opened is kept
+//
+void Benchmark::benchLoad(const QString& fileName, int size, std::unique_ptr<IndexService>& service)
+{
+    QList<double> Durations;
+    for (int Iteration = 0; Iteration < this->Iterations; Iteration++) {
+        service.reset();
+        service.reset(new IndexService(fileName));
+
+        QElapsedTimer Timer;
+        Timer.start();
+        service->waitForOpened();
+        Durations << Timer.nsecsElapsed() / 1e6;
+    }
+    record("load", size, Durations, size);
+}
+
+//  benchSearch
+//
+// Search each query. The index is touched before each iteration, so the result cache doesn't hide the search
+//
+void Benchmark::benchSearch(IndexService& service, int size)
+{
+    auto measure = [this, &service, size](const QString& name, const QString& query, bool wholeWords) {
+        QList<double> Durations;
+        for (int Iteration = 0; Iteration < this->Iterations; Iteration++) {
+            service.updateTB(0, *service.tb(0));
+
+            QElapsedTimer Timer;
+            Timer.start();
+            service.index()->search(query, ALL_FIELDS_MASK, wholeWords);
+            Durations << Timer.nsecsElapsed() / 1e6;
+        }
+        record(QString("%1[%2]").arg(name, query), size, Durations, 1);
+    };
+
+    for (const char* Query : WholeWordQueries) {
+        measure("search_whole", Query, true);
+    }
+    for (const char* Query : PartialQueries) {
+        measure("search_partial", Query, false);
+    }
+}
+
+//  benchPopulate
+//
+// Fill a table model with the whole index, then sort it by title
+//
+void Benchmark::benchPopulate(IndexService& service, int size)
+{
+    QList<double> Populate;
+    QList<double> Sort;
+    for (int Iteration = 0; Iteration < this->Iterations; Iteration++) {
+        TBTableModel  Model(service.index(), nullptr);
+        QElapsedTimer Timer;
+        Timer.start();
+        Model.appendLoaded(std::numeric_limits<int>::max());
+        Populate << Timer.nsecsElapsed() / 1e6;
+
+        Timer.restart();
+        Model.sort(COLUMN_TITLE);
+        Sort << Timer.nsecsElapsed() / 1e6;
+    }
+    record("populate", size, Populate, size);
+    record("sort_title", size, Sort, size);
+}
+
+//  report
+//
+// Return the results with the context of the measures
+//
+QJsonObject Benchmark::report() const
+{
+    QJsonObject Report;
+    Report.insert("date", QDateTime::currentDateTime().toString(Qt::ISODate));
+    Report.insert("qt", qVersion());
+    Report.insert("cpu", QSysInfo::currentCpuArchitecture());
+    Report.insert("os", QSysInfo::prettyProductName());
+    Report.insert("threads", QThread::idealThreadCount());
+    Report.insert("seed", static_cast<qint64>(this->Seed));
+    Report.insert("results", this->Results);
+    return Report;
+}
+
+//  compare
+//
+// Compare the medians to the ones of a baseline report, and return the number of regressions.
+// A measure regresses if it is slower than its baseline by more than the tolerance, and by more than the noise floor.
+// A baseline result can define its own "tolerance", for the noisy measures. Measures absent from the baseline are counted in missing
+//
+int Benchmark::compare(const QJsonObject& baseline, double tolerance, int* missing) const
+{
+    QHash<QString, QJsonObject> Baseline;
+    QJsonArray                  Results = baseline.value("results").toArray();
+    for (int i = 0; i < Results.count(); i++) {
+        QJsonObject Result = Results.at(i).toObject();
+        Baseline.insert(QString("%1 [%2]").arg(Result.value("name").toString()).arg(Result.value("size").toInt()), Result);
+    }
+
+    QTextStream Errors(stderr);
+    int         Regressions = 0;
+    *missing                = 0;
+    for (int i = 0; i < this->Results.count(); i++) {
+        QJsonObject Result = this->Results.at(i).toObject();
+        QString     Key    = QString("%1 [%2]").arg(Result.value("name").toString()).arg(Result.value("size").toInt());
+        if (!Baseline.contains(Key)) {
+            Errors << QString("%1: no baseline\n").arg(Key);
+            (*missing)++;
+            continue;
+        }
+
+        double Median    = Result.value("median_ms").toDouble();
+        double Reference = Baseline.value(Key).value("median_ms").toDouble();
+        double Tolerated = Reference * (1 + Baseline.value(Key).value("tolerance").toDouble(tolerance));
+        if ((Median > Tolerated) && (Median - Reference > BENCH_NOISE_FLOOR)) {
+            Errors << QString("REGRESSION %1: %2 ms, baseline %3 ms (%4%)\n")
+                          .arg(Key)
+                          .arg(Median, 0, 'f', 3)
+                          .arg(Reference, 0, 'f', 3)
+                          .arg(Reference > 0 ? (Median / Reference - 1) * 100 : 0, 0, 'f', 1);
+            Regressions++;
+        }
+    }
+
+    if (baseline.value("seed").toInteger() != static_cast<qint64>(this->Seed)) {
+        Errors << "Warning: the baseline was measured with another seed\n";
+    }
+    return Regressions;
+}
+
+//  checkScaling
+//
+// Compare each measure to the same measure at the previous index size, in this run, and return the number of regressions.
+// The measures grow linearly at most, n log n for the sort, so a measure regresses if it grows faster than the index by more than the tolerance.
+// It needs no baseline and doesn't depend on the machine: it detects the algorithmic regressions, not the constant ones.
+// The measures too short to be meaningful are not checked. The number of checks done is returned in checked
+//
+int Benchmark::checkScaling(double tolerance, int* checked) const
+{
+    QHash<QString, QJsonObject> Previous; // Last result of each measure, the sizes being increasing
+    QTextStream                 Errors(stderr);
+    int                         Regressions = 0;
+    *checked                                = 0;
+
+    for (int i = 0; i < this->Results.count(); i++) {
+        QJsonObject Result = this->Results.at(i).toObject();
+        QString     Name   = Result.value("name").toString();
+        if (Previous.contains(Name)) {
+            QJsonObject Smaller   = Previous.value(Name);
+            double      Median    = Result.value("median_ms").toDouble();
+            double      Reference = Smaller.value("median_ms").toDouble();
+            double      Growth    = Result.value("size").toDouble() / Smaller.value("size").toDouble();
+            if ((Growth > 1) && (Reference > BENCH_NOISE_FLOOR)) {
+                (*checked)++;
+                if (Median > Reference * Growth * (1 + tolerance)) {
+                    Errors << QString("REGRESSION %1: %2 ms at %3 TB, %4 ms at %5 TB (%6 times slower for %7 times more TB)\n")
+                                  .arg(Name)
+                                  .arg(Median, 0, 'f', 3)
+                                  .arg(Result.value("size").toInt())
+                                  .arg(Reference, 0, 'f', 3)
+                                  .arg(Smaller.value("size").toInt())
+                                  .arg(Median / Reference, 0, 'f', 1)
+                                  .arg(Growth, 0, 'f', 1);
+                    Regressions++;
+                }
+            }
+        }
+        Previous.insert(Name, Result);
+    }
+    return Regressions;
+}
+
+//  writeFile
+//
+// Write a report, return false on failure
+//
+static bool writeFile(const QString& fileName, const QByteArray& data)
+{
+    QFile File(fileName);
+    if (!File.open(QIODevice::WriteOnly) || (File.write(data) != data.size())) {
+        QTextStream(stderr) << QString("Impossible to write %1\n").arg(fileName);
+        return false;
+    }
+    return true;
+}
+
+//  main
+//
+// Without baseline, the report is written to the output. With a baseline, the measures are checked: their growth with
+// the index size (see checkScaling()), and their medians if the baseline exists. The exit code is BENCH_EXIT_REGRESSION
+// if any of them regressed, and BENCH_EXIT_SKIPPED if nothing could be checked.
+// The baseline is recorded only on request (--update-baseline)
+//
+int main(int argc, char* argv[])
+{
+    QCoreApplication Application(argc, argv);
+
+    QCommandLineParser Parser;
+    Parser.setApplicationDescription("Benchmark of the TBI hot paths. The results are written as JSON");
+    Parser.addHelpOption();
+    Parser.addOption(QCommandLineOption("sizes", "Comma separated index sizes.", "sizes", BENCH_DEFAULT_SIZES));
+    Parser.addOption(QCommandLineOption("iterations", "Iterations of each measure.", "count", QString::number(BENCH_DEFAULT_ITERATIONS)));
+    Parser.addOption(QCommandLineOption("seed", "Seed of the synthetic data.", "seed", QString::number(BENCH_DEFAULT_SEED)));
+    Parser.addOption(QCommandLineOption("cases", QString("Comma separated measures among %1.").arg(BENCH_CASES), "cases", BENCH_CASES));
+    Parser.addOption(QCommandLineOption("output", "JSON output file, standard output if omitted.", "file"));
+    Parser.addOption(QCommandLineOption("baseline", "Baseline report to compare with.", "file"));
+    Parser.addOption(QCommandLineOption("tolerance", "Relative slowdown tolerated before a regression is reported.", "ratio", QString::number(BENCH_DEFAULT_TOLERANCE)));
+    Parser.addOption(QCommandLineOption("scaling-tolerance", "Slowdown tolerated beyond a linear growth between two sizes.", "ratio", QString::number(BENCH_SCALING_TOLERANCE)));
+    Parser.addOption(QCommandLineOption("update-baseline", "Record the measures as the new baseline."));
+    Parser.process(Application);
+
+    QStringList Cases = Parser.value("cases").split(',', Qt::SkipEmptyParts);
+    QStringList Known = QString(BENCH_CASES).split(',');
+    for (int i = 0; i < Cases.count(); i++) {
+        if (!Known.contains(Cases.at(i))) {
+            QTextStream(stderr) << QString("Unknown measure %1\n").arg(Cases.at(i));
+            return 1;
+        }
+    }
+
+    // Without the baseline file, only the scaling is checked
+    QString Baseline = Parser.value("baseline");
+    bool    Existing = QFileInfo::exists(Baseline);
+    if (Parser.isSet("baseline") && !Parser.isSet("update-baseline") && !Existing) {
+        QTextStream(stderr) << QString("No baseline %1, only the scaling is checked. Record it with --update-baseline\n").arg(Baseline);
+    }
+
+    QTemporaryDir Directory;
+    if (!Directory.isValid()) {
+        QTextStream(stderr) << "Impossible to create a temporary directory\n";
+        return 1;
+    }
+
+    Benchmark   Bench(Parser.value("seed").toUInt(), std::max(1, Parser.value("iterations").toInt()), Directory.path(), Cases);
+    QStringList Sizes = Parser.value("sizes").split(',', Qt::SkipEmptyParts);
+    for (int i = 0; i < Sizes.count(); i++) {
+        Bench.run(Sizes.at(i).toInt());
+    }
+
+    QByteArray Json = QJsonDocument(Bench.report()).toJson();
+    if (Parser.isSet("output")) {
+        if (!writeFile(Parser.value("output"), Json)) {
+            return 1;
+        }
+    }
+    else if (!Parser.isSet("baseline")) {
+        QTextStream(stdout) << Json;
+    }
+
+    if (!Parser.isSet("baseline")) {
+        return 0;
+    }
+    if (Parser.isSet("update-baseline")) {
+        if (!writeFile(Baseline, Json)) {
+            return 1;
+        }
+        QTextStream(stderr) << QString("Baseline recorded in %1\n").arg(Baseline);
+        return 0;
+    }
+
+    // Regression check
+    int Checked     = 0;
+    int Regressions = Bench.checkScaling(Parser.value("scaling-tolerance").toDouble(), &Checked);
+    int Missing     = 0;
+    if (Existing) {
+        QFile         File(Baseline);
+        QJsonDocument Document = File.open(QIODevice::ReadOnly) ? QJsonDocument::fromJson(File.readAll()) : QJsonDocument();
+        if (!Document.isObject()) {
+            QTextStream(stderr) << QString("Invalid baseline %1\n").arg(Baseline);
+            return 1;
+        }
+        Regressions += Bench.compare(Document.object(), Parser.value("tolerance").toDouble(), &Missing);
+        Checked += Bench.count() - Missing;
+    }
+
+    QTextStream(stderr) << QString("%1 regression(s), %2 check(s), %3 measure(s) without baseline\n").arg(Regressions).arg(Checked).arg(Missing);
+    if (Regressions != 0) {
+        return BENCH_EXIT_REGRESSION;
+    }
+    return Checked == 0 ? BENCH_EXIT_SKIPPED : 0;
+}
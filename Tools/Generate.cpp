@@ -0,0 +1,81 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "Index/ThreadIndex.hpp"
+#include "TBGenerator.hpp"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QTextStream>
+
+#define GENERATE_DEFAULT_COUNT 100000
+#define GENERATE_DEFAULT_SEED  20201
+
+//  main
+//
+// Write a synthetic index file, to test TBI at scale:
+//   tbi_generate --count 1000000 --seed 42 index.tbi
+//
+int main(int argc, char* argv[])
+{
+    QCoreApplication Application(argc, argv);
+
+    QCommandLineParser Parser;
+    Parser.setApplicationDescription("Generate a synthetic TBI index file");
+    Parser.addHelpOption();
+    Parser.addOption(QCommandLineOption("count", "Number of TB.", "count", QString::number(GENERATE_DEFAULT_COUNT)));
+    Parser.addOption(QCommandLineOption("seed", "Seed of the generator, the same seed gives the same file.", "seed", QString::number(GENERATE_DEFAULT_SEED)));
+    Parser.addOption(QCommandLineOption("format-version", "Version of the file format, 0 (legacy) to current.", "version", QString::number(CURRENT_TBI_VERSION)));
+    Parser.addPositionalArgument("file", "Index file to write.");
+    Parser.process(Application);
+
+    QTextStream Errors(stderr);
+    if (Parser.positionalArguments().count() != 1) {
+        Parser.showHelp(1);
+    }
+
+    bool   Valid;
+    qint32 Count   = Parser.value("count").toInt(&Valid);
+    qint32 Version = Parser.value("format-version").toInt();
+    if (!Valid || (Count < 0) || (Version < 0) || (Version > CURRENT_TBI_VERSION)) {
+        Errors << "Invalid count or format version\n";
+        return 1;
+    }
+
+    // The file replaces an existing one only once it is completely written
+    QSaveFile File(Parser.positionalArguments().first());
+    if (!File.open(QIODevice::WriteOnly)) {
+        Errors << QString("Impossible to open %1\n").arg(File.fileName());
+        return 1;
+    }
+
+    QElapsedTimer Timer;
+    Timer.start();
+    TBGenerator Generator(Parser.value("seed").toUInt());
+    if (!Generator.write(&File, Count, Version) || !File.commit()) {
+        Errors << QString("Impossible to write %1\n").arg(File.fileName());
+        return 1;
+    }
+
+    Errors << QString("%1 TB written in %2 ms\n").arg(Count).arg(Timer.elapsed());
+    return 0;
+}
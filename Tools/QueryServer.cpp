@@ -0,0 +1,349 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "QueryServer.hpp"
+#include "Index/Query.hpp"
+#include "Index/RecordImporter.hpp"
+#include "Index/TBExporter.hpp"
+#include <QBitArray>
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QMetaObject>
+#include <QUrl>
+#include <algorithm>
+
+QueryServer::QueryServer(IndexService* service, int threads, QObject* parent)
+    : QTcpServer(parent)
+    , Service(service)
+    , Current(service->snapshot())
+{
+    this->Workers.setMaxThreadCount(threads);
+
+    // Writes are grouped: the snapshot is published after the first one, the index is saved after the last one
+    this->PublishTimer.setSingleShot(true);
+    this->PublishTimer.setInterval(SERVER_PUBLISH_DELAY);
+    connect(&this->PublishTimer, &QTimer::timeout, this, [this]() { this->Current = this->Service->snapshot(); });
+
+    this->SaveTimer.setSingleShot(true);
+    this->SaveTimer.setInterval(SERVER_SAVE_DELAY);
+    connect(&this->SaveTimer, &QTimer::timeout, this, [this]() { this->Service->save(NO_BACKUP_ON_SAVE); });
+}
+
+QueryServer::~QueryServer()
+{
+    // A worker may wait for a write to be done in this thread, so the events are processed until they are all finished
+    close();
+    while (!this->Workers.waitForDone(10)) {
+        QCoreApplication::processEvents();
+    }
+    if (this->SaveTimer.isActive()) {
+        this->Service->save(NO_BACKUP_ON_SAVE);
+    }
+}
+
+//  incomingConnection
+//
+// Give the connection to a worker, with the current snapshot
+//
+void QueryServer::incomingConnection(qintptr descriptor)
+{
+    this->Workers.start(new RequestHandler(descriptor, this->Current, this));
+}
+
+//  addTB
+//
+// Add a TB to the index. Called by the workers, executed in the index thread
+//
+HttpResponse QueryServer::addTB(const QJsonObject& object)
+{
+    QString            Message;
+    TechnicalBulletin* TB = RecordImporter::createTB(RecordImporter::jsonValues(object), &Message);
+    if (TB == nullptr) {
+        return RequestHandler::error(400, Message);
+    }
+    if (this->Service->findTB(TB->number()) != INVALID_TB_ID) {
+        Message = QString("TB %1 is already present in the index").arg(TB->number());
+        delete TB;
+        return RequestHandler::error(409, Message);
+    }
+
+    QJsonObject Body;
+    Body.insert("number", TB->number());
+    Body.insert("id", this->Service->addTB(TB));
+    Body.insert("generation", static_cast<qint64>(this->Service->index()->generation()));
+    Body.insert("saved", false); // Saved with the next writes, see SERVER_SAVE_DELAY
+
+    if (!this->PublishTimer.isActive()) {
+        this->PublishTimer.start();
+    }
+    this->SaveTimer.start();
+    return HttpResponse{201, Body};
+}
+
+RequestHandler::RequestHandler(qintptr descriptor, const QSharedPointer<const IndexSnapshot>& snapshot, QueryServer* server)
+    : Descriptor(descriptor)
+    , Snapshot(snapshot)
+    , Server(server)
+{
+}
+
+//  run
+//
+// Handle a single request. The connection is closed once the response is sent
+//
+void RequestHandler::run()
+{
+    QTcpSocket Socket;
+    if (!Socket.setSocketDescriptor(this->Descriptor)) {
+        return;
+    }
+
+    HttpRequest  Request;
+    HttpResponse Response;
+    if (readRequest(Socket, Request, Response)) {
+        Response = handle(Request);
+    }
+    if (Socket.state() == QAbstractSocket::ConnectedState) {
+        writeResponse(Socket, Response);
+    }
+}
+
+//  readRequest
+//
+// Read the request line, the headers and the body. Return false if the request can't be handled,
+// the response to send is then in failure
+//
+bool RequestHandler::readRequest(QTcpSocket& socket, HttpRequest& request, HttpResponse& failure)
+{
+    QByteArray Data;
+    qsizetype  HeaderEnd;
+    while ((HeaderEnd = Data.indexOf("\r\n\r\n")) < 0) {
+        if (Data.size() > SERVER_MAX_HEADER_SIZE) {
+            failure = error(431, "Request headers too large");
+            return false;
+        }
+        if (!socket.waitForReadyRead(SERVER_TIMEOUT)) {
+            failure = error(408, "Request timeout");
+            return false;
+        }
+        Data += socket.readAll();
+    }
+
+    // Request line: method, target, version
+    QList<QByteArray> Lines       = Data.left(HeaderEnd).split('\n');
+    QList<QByteArray> RequestLine = Lines.first().trimmed().split(' ');
+    if ((RequestLine.count() != 3) || !RequestLine.at(2).startsWith("HTTP/")) {
+        failure = error(400, "Invalid request line");
+        return false;
+    }
+    QUrl Url       = QUrl::fromEncoded(RequestLine.at(1));
+    request.Method = RequestLine.at(0);
+    request.Path   = Url.path();
+    request.Query  = QUrlQuery(Url.query(QUrl::FullyEncoded).replace('+', "%20")); // Forms encode the spaces as '+', a real '+' is sent as %2B
+
+    // Only the body length is used in the headers
+    qint64 Length = 0;
+    for (int i = 1; i < Lines.count(); i++) {
+        qsizetype Colon = Lines.at(i).indexOf(':');
+        if ((Colon > 0) && (Lines.at(i).left(Colon).trimmed().toLower() == "content-length")) {
+            bool Valid;
+            Length = Lines.at(i).mid(Colon + 1).trimmed().toLongLong(&Valid);
+            if (!Valid || (Length < 0)) {
+                failure = error(400, "Invalid Content-Length");
+                return false;
+            }
+        }
+    }
+    if (Length > SERVER_MAX_BODY_SIZE) {
+        failure = error(413, "Request body too large");
+        return false;
+    }
+
+    request.Body = Data.mid(HeaderEnd + 4);
+    while (request.Body.size() < Length) {
+        if (!socket.waitForReadyRead(SERVER_TIMEOUT)) {
+            failure = error(408, "Request timeout");
+            return false;
+        }
+        request.Body += socket.readAll();
+    }
+    request.Body.truncate(Length);
+    return true;
+}
+
+//  handle
+//
+// Route a request
+//
+HttpResponse RequestHandler::handle(const HttpRequest& request)
+{
+    bool Get  = request.Method == "GET";
+    bool Post = request.Method == "POST";
+
+    if (request.Path == "/status") {
+        return Get ? status() : error(405, "Method not allowed");
+    }
+    if (request.Path == "/search") {
+        return Get ? search(request.Query) : error(405, "Method not allowed");
+    }
+    if (request.Path == "/tb") {
+        return Post ? addTB(request.Body) : error(405, "Method not allowed");
+    }
+    if (request.Path.startsWith("/tb/")) {
+        return Get ? getTB(request.Path.mid(4)) : error(405, "Method not allowed");
+    }
+    return error(404, "Unknown resource");
+}
+
+HttpResponse RequestHandler::status()
+{
+    QJsonObject Body;
+    Body.insert("count", this->Snapshot->count());
+    Body.insert("generation", static_cast<qint64>(this->Snapshot->generation()));
+    return HttpResponse{200, Body};
+}
+
+//  search
+//
+// Search the snapshot. All the matching TB are counted, only the first ones are returned
+//
+HttpResponse RequestHandler::search(const QUrlQuery& query)
+{
+    QString Text = query.queryItemValue("q", QUrl::FullyDecoded);
+    if (Text.trimmed().isEmpty()) {
+        return error(400, "Missing query (q)");
+    }
+
+    quint32 Fields = ALL_FIELDS_MASK;
+    if (query.hasQueryItem("fields")) {
+        Fields            = 0;
+        QStringList Names = query.queryItemValue("fields", QUrl::FullyDecoded).split(',', Qt::SkipEmptyParts);
+        for (int i = 0; i < Names.count(); i++) {
+            TB_FIELD Field;
+            if (!Query::fieldFromName(Names.at(i).trimmed(), &Field)) {
+                return error(400, QString("Unknown field: %1").arg(Names.at(i)));
+            }
+            Fields |= FIELD_MASK(Field);
+        }
+    }
+
+    int Limit = SERVER_DEFAULT_LIMIT;
+    if (query.hasQueryItem("limit")) {
+        bool Valid;
+        Limit = query.queryItemValue("limit").toInt(&Valid);
+        if (!Valid || (Limit < 0)) {
+            return error(400, "Invalid limit");
+        }
+        Limit = std::min(Limit, SERVER_MAX_LIMIT);
+    }
+
+    QString   Whole  = query.queryItemValue("whole");
+    QBitArray Result = this->Snapshot->search(Text, Fields, (Whole == "1") || (Whole == "true"));
+
+    QJsonArray Records;
+    int        Count = 0;
+    for (qint32 Id = 0; Id < Result.size(); Id++) {
+        const TechnicalBulletin* TB = this->Snapshot->tb(Id);
+        if (!Result.testBit(Id) || (TB == nullptr)) {
+            continue;
+        }
+        if (Records.count() < Limit) {
+            Records.append(TBExporter::jsonObject(*TB));
+        }
+        Count++;
+    }
+
+    QJsonObject Body;
+    Body.insert("generation", static_cast<qint64>(this->Snapshot->generation()));
+    Body.insert("count", Count);
+    Body.insert("results", Records);
+    return HttpResponse{200, Body};
+}
+
+HttpResponse RequestHandler::getTB(const QString& number)
+{
+    const TechnicalBulletin* TB = this->Snapshot->tb(this->Snapshot->findTB(number));
+    if (TB == nullptr) {
+        return error(404, QString("TB %1 not found").arg(number));
+    }
+    return HttpResponse{200, TBExporter::jsonObject(*TB)};
+}
+
+//  addTB
+//
+// Parse the TB, then wait for the index thread to add it
+//
+HttpResponse RequestHandler::addTB(const QByteArray& body)
+{
+    QJsonParseError Error;
+    QJsonDocument   Document = QJsonDocument::fromJson(body, &Error);
+    if (!Document.isObject()) {
+        return error(400, QString("Not a JSON object (%1)").arg(Error.errorString()));
+    }
+
+    HttpResponse Response;
+    QJsonObject  Object = Document.object();
+    QMetaObject::invokeMethod(this->Server, [this, &Response, &Object]() { Response = this->Server->addTB(Object); }, Qt::BlockingQueuedConnection);
+    return Response;
+}
+
+HttpResponse RequestHandler::error(int status, const QString& message)
+{
+    QJsonObject Body;
+    Body.insert("error", message);
+    return HttpResponse{status, Body};
+}
+
+//  writeResponse
+//
+// Send a response, then close the connection
+//
+void RequestHandler::writeResponse(QTcpSocket& socket, const HttpResponse& response)
+{
+    QByteArray Reason;
+    switch (response.Status) {
+        case 200: Reason = "OK"; break;
+        case 201: Reason = "Created"; break;
+        case 400: Reason = "Bad Request"; break;
+        case 404: Reason = "Not Found"; break;
+        case 405: Reason = "Method Not Allowed"; break;
+        case 408: Reason = "Request Timeout"; break;
+        case 409: Reason = "Conflict"; break;
+        case 413: Reason = "Payload Too Large"; break;
+        case 431: Reason = "Request Header Fields Too Large"; break;
+        default: Reason = "Error";
+    }
+
+    QByteArray Body = QJsonDocument(response.Body).toJson(QJsonDocument::Compact);
+    QByteArray Head = QString("HTTP/1.1 %1 %2\r\nContent-Type: application/json; charset=utf-8\r\nContent-Length: %3\r\nConnection: close\r\n\r\n")
+                          .arg(response.Status)
+                          .arg(QString::fromLatin1(Reason))
+                          .arg(Body.size())
+                          .toLatin1();
+
+    socket.write(Head + Body);
+    socket.disconnectFromHost();
+    if (socket.state() != QAbstractSocket::UnconnectedState) {
+        socket.waitForDisconnected(SERVER_TIMEOUT);
+    }
+}
@@ -0,0 +1,144 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef QUERYSERVER_HPP
+#define QUERYSERVER_HPP
+
+#include "Index/IndexService.hpp"
+#include "Index/IndexSnapshot.hpp"
+#include <QByteArray>
+#include <QJsonObject>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrlQuery>
+
+//  HttpRequest
+//
+// Request read by a worker. Only the parts used by the server are kept
+//
+struct HttpRequest
+{
+    QByteArray Method;
+    QString    Path;
+    QUrlQuery  Query;
+    QByteArray Body;
+};
+
+//  HttpResponse
+//
+// Status and JSON body of a response
+//
+struct HttpResponse
+{
+    int         Status;
+    QJsonObject Body;
+};
+
+//  QueryServer
+//
+// HTTP/JSON server sharing a loaded index with many clients:
+//   GET  /status            number of TB and generation of the index
+//   GET  /search?q=...      search, with the optional parameters fields=title,notes  whole=1  limit=100
+//   GET  /tb/<number>       TB with this number
+//   POST /tb                add a TB, given as a JSON object like the JSON Lines export
+//
+// The server lives in the thread of the index. It only accepts the connections, then each request is handled
+// by a worker of a thread pool, with the snapshot of the index current at that time: the readers never lock anything.
+// The writes are sent back to the index thread, so they are serialized. A new snapshot is published shortly after,
+// grouping the writes received meanwhile, and the index is saved when no write was received for a while, or when the
+// server stops. A TB added is not on disk yet when the answer is sent, so the answer contains "saved": false
+//
+class QueryServer: public QTcpServer
+{
+    Q_OBJECT
+
+  public:
+    QueryServer(IndexService* service, int threads, QObject* parent = nullptr);
+    ~QueryServer() override;
+
+    HttpResponse addTB(const QJsonObject& object);
+
+  protected:
+    void incomingConnection(qintptr descriptor) override;
+
+  private:
+    IndexService*                       Service;
+    QThreadPool                         Workers;
+    QSharedPointer<const IndexSnapshot> Current;
+    QTimer                              PublishTimer;
+    QTimer                              SaveTimer;
+};
+
+//  RequestHandler
+//
+// Read a request, answer it, then close the connection. Runs in a worker thread
+//
+class RequestHandler: public QRunnable
+{
+  public:
+    RequestHandler(qintptr descriptor, const QSharedPointer<const IndexSnapshot>& snapshot, QueryServer* server);
+    void run() override;
+
+    static HttpResponse error(int status, const QString& message);
+
+  private:
+    qintptr                             Descriptor;
+    QSharedPointer<const IndexSnapshot> Snapshot;
+    QueryServer*                        Server;
+
+    bool         readRequest(QTcpSocket& socket, HttpRequest& request, HttpResponse& failure);
+    HttpResponse handle(const HttpRequest& request);
+    HttpResponse status();
+    HttpResponse search(const QUrlQuery& query);
+    HttpResponse getTB(const QString& number);
+    HttpResponse addTB(const QByteArray& body);
+    static void  writeResponse(QTcpSocket& socket, const HttpResponse& response);
+};
+
+// Default port
+#define SERVER_DEFAULT_PORT 8080
+
+// Network timeout of a worker (ms)
+#define SERVER_TIMEOUT 5000
+
+// Max size of the request line and headers, and of the body (bytes)
+#define SERVER_MAX_HEADER_SIZE (16 * 1024)
+#define SERVER_MAX_BODY_SIZE   (1024 * 1024)
+
+// Number of TB returned by a search, by default and at most
+#define SERVER_DEFAULT_LIMIT 100
+#define SERVER_MAX_LIMIT     10000
+
+// Delay between a write and the publication of the new snapshot (ms)
+#define SERVER_PUBLISH_DELAY 100
+
+// Delay without write before the index is saved (ms)
+#define SERVER_SAVE_DELAY 5000
+
+// Interval between two checks of a stop signal (ms)
+#define SERVER_STOP_POLL_INTERVAL 200
+
+#endif // QUERYSERVER_HPP
@@ -0,0 +1,89 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "Index/IndexService.hpp"
+#include "QueryServer.hpp"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <csignal>
+
+// Set by SIGINT and SIGTERM, polled by the event loop
+static volatile std::sig_atomic_t StopRequested = 0;
+
+static void requestStop(int)
+{
+    StopRequested = 1;
+}
+
+//  main
+//
+// Headless server: load an index once, then answer the queries of the clients over HTTP:
+//   tbi_server --port 8080 index.tbi
+// It listens on the local host by default, use --address 0.0.0.0 to serve the workshop network
+//
+int main(int argc, char* argv[])
+{
+    QCoreApplication Application(argc, argv);
+
+    QCommandLineParser Parser;
+    Parser.setApplicationDescription("TBI query server");
+    Parser.addHelpOption();
+    Parser.addOption(QCommandLineOption("address", "Listening address.", "address", QHostAddress(QHostAddress::LocalHost).toString()));
+    Parser.addOption(QCommandLineOption("port", "Listening port.", "port", QString::number(SERVER_DEFAULT_PORT)));
+    Parser.addOption(QCommandLineOption("threads", "Number of worker threads.", "count", QString::number(QThread::idealThreadCount())));
+    Parser.addPositionalArgument("file", "Index file, " TBI_FILENAME " if omitted.");
+    Parser.process(Application);
+
+    QTextStream Errors(stderr);
+    QString     FileName = Parser.positionalArguments().isEmpty() ? QString(TBI_FILENAME) : Parser.positionalArguments().first();
+
+    IndexService Service(FileName);
+    QObject::connect(&Service, &IndexService::openingFailed, [&Errors](QString reason) { Errors << reason << "\n"; });
+    if (!Service.waitForOpened()) {
+        return 1;
+    }
+
+    QueryServer Server(&Service, std::max(1, Parser.value("threads").toInt()));
+    if (!Server.listen(QHostAddress(Parser.value("address")), Parser.value("port").toUShort())) {
+        Errors << QString("Impossible to listen on %1:%2: %3\n").arg(Parser.value("address"), Parser.value("port"), Server.errorString());
+        return 1;
+    }
+
+    // Stopping the event loop destroys the server normally, which saves the writes not saved yet
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    QTimer StopTimer;
+    QObject::connect(&StopTimer, &QTimer::timeout, &Application, []() {
+        if (StopRequested != 0) {
+            QCoreApplication::quit();
+        }
+    });
+    StopTimer.start(SERVER_STOP_POLL_INTERVAL);
+
+    Errors << QString("%1 TB loaded from %2, listening on %3:%4\n").arg(Service.count()).arg(FileName, Server.serverAddress().toString()).arg(Server.serverPort());
+    Errors.flush();
+    return Application.exec();
+}
@@ -0,0 +1,208 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "TBGenerator.hpp"
+#include "Index/ThreadIndex.hpp"
+#include <QDataStream>
+#include <algorithm>
+#include <cmath>
+
+// Most frequent words of the real TB. The rest of the vocabulary is made of syllables
+static const char* CommonWords[] = {"valve",    "pump",     "filler",   "sealing",  "jaw",          "inductor", "sterilizer", "conveyor",
+                                    "sensor",   "motor",    "cylinder", "bearing",  "gasket",       "nozzle",   "heater",     "cutter",
+                                    "folder",   "straw",    "cap",      "hose",     "membrane",     "spring",   "shaft",      "coupling",
+                                    "gearbox",  "servo",    "encoder",  "pressure", "temperature",  "leak",     "wear",       "upgrade",
+                                    "kit",      "software", "update",   "safety",   "modification", "hygiene",  "cleaning",   "applicator"};
+static const char* Syllables[]   = {"ka", "to", "ri", "mel", "on", "sta", "vex", "dor", "pli", "an", "ter", "gu", "sen", "ox", "ba", "li"};
+static const char* Categories[]  = {"Safety",   "Quality",    "Production", "Hygiene",   "Maintenance", "Upgrade",   "Environment",
+                                    "Software", "Electrical", "Mechanical", "Packaging", "Training",    "Spare parts", "Documentation"};
+
+TBGenerator::TBGenerator(quint32 seed)
+    : Random(seed)
+    , WordWeights(zipfWeights(GENERATOR_VOCABULARY_SIZE, GENERATOR_WORD_EXPONENT))
+    , CategoryWeights(zipfWeights(sizeof(Categories) / sizeof(Categories[0]), GENERATOR_CATEGORY_EXPONENT))
+    , AuthorWeights(zipfWeights(GENERATOR_AUTHOR_COUNT, GENERATOR_AUTHOR_EXPONENT))
+    , Id(0)
+    , ChainPosition(0)
+    , ChainLength(1)
+{
+    // Common words first, so they get the highest frequencies
+    int CommonCount   = sizeof(CommonWords) / sizeof(CommonWords[0]);
+    int SyllableCount = sizeof(Syllables) / sizeof(Syllables[0]);
+    this->Vocabulary.reserve(GENERATOR_VOCABULARY_SIZE);
+    for (int i = 0; i < CommonCount; i++) {
+        this->Vocabulary << CommonWords[i];
+    }
+
+    // Then the other words are written with the digits of their rank in base "syllable count".
+    // One word in ten is a part number
+    for (int Rank = CommonCount; this->Vocabulary.count() < GENERATOR_VOCABULARY_SIZE; Rank++) {
+        if (Rank % 10 == 0) {
+            this->Vocabulary << QString("P%1").arg(Rank * 7919 % 1000000, 6, 10, QChar('0'));
+            continue;
+        }
+        QString Word;
+        for (int Value = Rank; Value != 0; Value /= SyllableCount) {
+            Word += Syllables[Value % SyllableCount];
+        }
+        this->Vocabulary << Word;
+    }
+}
+
+//  zipfWeights
+//
+// Return the cumulative weights of a Zipf distribution: the rank k has a weight 1 / k^exponent
+//
+std::vector<double> TBGenerator::zipfWeights(int count, double exponent)
+{
+    std::vector<double> Weights(count);
+    double              Sum = 0;
+    for (int i = 0; i < count; i++) {
+        Sum += 1.0 / std::pow(i + 1, exponent);
+        Weights[i] = Sum;
+    }
+    return Weights;
+}
+
+//  draw
+//
+// Return a rank drawn according to cumulative weights
+//
+int TBGenerator::draw(const std::vector<double>& weights)
+{
+    double Value = this->Random.generateDouble() * weights.back();
+    return static_cast<int>(std::upper_bound(weights.begin(), weights.end(), Value) - weights.begin());
+}
+
+//  words
+//
+// Return a text made of random words
+//
+QString TBGenerator::words(int count)
+{
+    QString Text;
+    for (int i = 0; i < count; i++) {
+        if (i != 0) {
+            Text += ' ';
+        }
+        Text += this->Vocabulary.at(draw(this->WordWeights));
+    }
+    return Text;
+}
+
+//  comment
+//
+// Return a comment, written in paragraphs. Most comments are short, some are very long
+//
+QString TBGenerator::comment()
+{
+    int     Length  = this->Random.bounded(this->Random.bounded(100) < GENERATOR_LONG_COMMENT_PERCENT ? GENERATOR_LONG_COMMENT_WORDS : GENERATOR_SHORT_COMMENT_WORDS);
+    QString Comment;
+    while (Length > 0) {
+        int Paragraph = std::min(Length, 20 + static_cast<int>(this->Random.bounded(60)));
+        if (!Comment.isEmpty()) {
+            Comment += '\n';
+        }
+        Comment += words(Paragraph);
+        Length -= Paragraph;
+    }
+    return Comment;
+}
+
+//  number
+//
+// Return the number of the TB generated with an id
+//
+QString TBGenerator::number(qint64 id)
+{
+    return QString("TB%1").arg(id, 7, 10, QChar('0'));
+}
+
+//  next
+//
+// Generate the next TB.
+// The TB of a replacement chain are consecutive, so a TB knows the numbers of the TB it replaces and is replaced by
+// without keeping anything in memory
+//
+TechnicalBulletin TBGenerator::next()
+{
+    // Start a new chain, or a standalone TB
+    if (this->ChainPosition == this->ChainLength) {
+        this->ChainPosition = 0;
+        this->ChainLength   = this->Random.bounded(100) < GENERATOR_CHAIN_PERCENT ? 2 + this->Random.bounded(GENERATOR_CHAIN_MAX_LENGTH - 1) : 1;
+        this->ChainDate     = QDate(GENERATOR_FIRST_YEAR + this->Random.bounded(GENERATOR_YEAR_SPAN), 1, 1).addDays(this->Random.bounded(365));
+    }
+    else {
+        // A new version is released a few months after the previous one
+        this->ChainDate = this->ChainDate.addDays(30 + this->Random.bounded(700));
+    }
+
+    QString Replaces   = this->ChainPosition != 0 ? number(this->Id - 1) : QString();
+    QString ReplacedBy = this->ChainPosition != this->ChainLength - 1 ? number(this->Id + 1) : QString();
+
+    QStringList Keywords;
+    for (int Count = this->Random.bounded(5); Count > 0; Count--) {
+        Keywords << this->Vocabulary.at(draw(this->WordWeights));
+    }
+
+    TechnicalBulletin TB(number(this->Id),
+                         words(3 + this->Random.bounded(10)),
+                         Categories[draw(this->CategoryWeights)],
+                         this->Random.bounded(3) != 0 ? QString("RK%1").arg(this->Random.bounded(10000), 5, 10, QChar('0')) : QString(),
+                         this->Random.bounded(2) != 0 ? QString("TP%1").arg(this->Random.bounded(5000), 4, 10, QChar('0')) : QString(),
+                         comment(),
+                         this->ChainDate,
+                         QString("Engineer %1").arg(draw(this->AuthorWeights)),
+                         Replaces,
+                         ReplacedBy,
+                         Keywords);
+
+    this->Id++;
+    this->ChainPosition++;
+    return TB;
+}
+
+//  write
+//
+// Write an index file of a given format version. The TB are written as soon as they are generated.
+// Version 0 is the legacy unversioned format, see ThreadIndex::run() for the layout
+//
+bool TBGenerator::write(QIODevice* device, qint32 count, qint32 version)
+{
+    QDataStream Stream(device);
+    switch (version) {
+        case 0:
+            Stream << count;
+            break;
+
+        case 1:
+            Stream << qint32(0) << QString(TBI_MAGIC) << qint32(1) << count;
+            break;
+
+        default:
+            return false;
+    }
+
+    for (qint32 i = 0; (i < count) && (Stream.status() == QDataStream::Ok); i++) {
+        Stream << next();
+    }
+    return Stream.status() == QDataStream::Ok;
+}
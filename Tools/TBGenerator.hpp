@@ -0,0 +1,91 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef TBGENERATOR_HPP
+#define TBGENERATOR_HPP
+
+#include "Index/TechnicalBulletin.hpp"
+#include <QDate>
+#include <QIODevice>
+#include <QList>
+#include <QRandomGenerator>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+//  TBGenerator
+//
+// Seeded generator of realistic TB, used to test TBI at scale.
+// Words follow a Zipf distribution over a fixed vocabulary, categories and authors are shared by many TB,
+// some TB form replacement chains, and comments can be long.
+// TB are produced one at a time, so the memory used doesn't depend on the number of TB generated
+//
+class TBGenerator
+{
+  public:
+    TBGenerator(quint32 seed);
+    TechnicalBulletin next();
+    bool              write(QIODevice* device, qint32 count, qint32 version);
+
+    static QString number(qint64 id);
+
+  private:
+    QRandomGenerator    Random;
+    QStringList         Vocabulary;
+    std::vector<double> WordWeights;     // Cumulative Zipf weights of the vocabulary
+    std::vector<double> CategoryWeights; // Cumulative Zipf weights of the categories
+    std::vector<double> AuthorWeights;   // Cumulative Zipf weights of the authors
+    qint64              Id;
+    int                 ChainPosition; // Position of the current TB in its replacement chain
+    int                 ChainLength;   // Length of the current chain, 1 if the TB is not part of a chain
+    QDate               ChainDate;     // Release date of the previous TB of the chain
+
+    static std::vector<double> zipfWeights(int count, double exponent);
+    int                        draw(const std::vector<double>& weights);
+    QString                    words(int count);
+    QString                    comment();
+};
+
+// Size of the vocabulary used for titles, comments and keywords
+#define GENERATOR_VOCABULARY_SIZE 20000
+
+// Exponents of the Zipf distributions. Greater exponent: a few values are used much more often
+#define GENERATOR_WORD_EXPONENT     1.07
+#define GENERATOR_CATEGORY_EXPONENT 1.3
+#define GENERATOR_AUTHOR_EXPONENT   0.9
+
+// Number of authors
+#define GENERATOR_AUTHOR_COUNT 200
+
+// Replacement chains: probability (in percent) that a TB starts a chain, and maximal length of a chain
+#define GENERATOR_CHAIN_PERCENT    8
+#define GENERATOR_CHAIN_MAX_LENGTH 6
+
+// Probability (in percent) of a long comment, and length in words of short and long comments
+#define GENERATOR_LONG_COMMENT_PERCENT 10
+#define GENERATOR_SHORT_COMMENT_WORDS  40
+#define GENERATOR_LONG_COMMENT_WORDS   1500
+
+// Release dates are spread over this period
+#define GENERATOR_FIRST_YEAR 1995
+#define GENERATOR_YEAR_SPAN  30
+
+#endif // TBGENERATOR_HPP
@@ -0,0 +1,186 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "Trace.hpp"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <memory>
+#include <vector>
+
+std::atomic<bool> Trace::Enabled(false);
+
+// Event recorded by a thread
+struct TraceEvent
+{
+    const char* Name;
+    qint64      Start; // ns since the trace was enabled
+    qint64      End;
+};
+
+// Ring buffer of a thread. Only this thread writes into it
+struct TraceBuffer
+{
+    int                     Id;
+    QString                 Name;
+    std::vector<TraceEvent> Events;
+    quint64                 Count; // Number of events recorded, including the overwritten ones
+};
+
+// Give back the buffer of a thread when it exits, so that a later thread reuses it
+struct TraceBufferOwner
+{
+    TraceBuffer* Buffer = nullptr;
+    ~TraceBufferOwner();
+};
+
+static QElapsedTimer                             Clock;
+static QMutex                                    BuffersMutex; // Protects the lists, not the buffers
+static std::vector<std::unique_ptr<TraceBuffer>> Buffers;
+static std::vector<TraceBuffer*>                 FreeBuffers; // Buffers of the exited threads
+static thread_local TraceBufferOwner             CurrentBuffer;
+
+TraceBufferOwner::~TraceBufferOwner()
+{
+    if (this->Buffer != nullptr) {
+        QMutexLocker Locker(&BuffersMutex);
+        FreeBuffers.push_back(this->Buffer);
+    }
+}
+
+// Return the buffer of the current thread, taken at its first event. The buffer of an exited thread is reused
+// with its events and its id, because the short-lived threads of a pool would otherwise allocate a buffer each.
+// Their events don't overlap, so they are shown on the same track
+static TraceBuffer* threadBuffer()
+{
+    if (CurrentBuffer.Buffer == nullptr) {
+        QMutexLocker Locker(&BuffersMutex);
+        if (!FreeBuffers.empty()) {
+            CurrentBuffer.Buffer = FreeBuffers.back();
+            FreeBuffers.pop_back();
+            return CurrentBuffer.Buffer;
+        }
+
+        Buffers.push_back(std::make_unique<TraceBuffer>());
+        TraceBuffer* Buffer  = Buffers.back().get();
+        CurrentBuffer.Buffer = Buffer;
+        Buffer->Id           = static_cast<int>(Buffers.size());
+        Buffer->Count        = 0;
+        Buffer->Events.resize(TRACE_BUFFER_SIZE);
+
+        QThread* Thread = QThread::currentThread();
+        Buffer->Name    = Thread->objectName();
+        if (Buffer->Name.isEmpty()) {
+            bool Main    = (QCoreApplication::instance() != nullptr) && (Thread == QCoreApplication::instance()->thread());
+            Buffer->Name = Main ? QString("Main") : QString("Thread %1").arg(Buffer->Id);
+        }
+    }
+    return CurrentBuffer.Buffer;
+}
+
+//  enable
+//
+// Start recording. It should be called at startup, before the other threads are created
+//
+void Trace::enable()
+{
+    Clock.start();
+    Enabled.store(true);
+}
+
+//  setThreadName
+//
+// Name the current thread in the trace
+//
+void Trace::setThreadName(const QString& name)
+{
+    if (isEnabled()) {
+        threadBuffer()->Name = name;
+    }
+}
+
+qint64 Trace::now()
+{
+    return Clock.nsecsElapsed();
+}
+
+void Trace::record(const char* name, qint64 start, qint64 end)
+{
+    TraceBuffer* Buffer = threadBuffer();
+    Buffer->Events[Buffer->Count % TRACE_BUFFER_SIZE] = TraceEvent{name, start, end};
+    Buffer->Count++;
+}
+
+//  write
+//
+// Write the events of all the threads as complete events ("X"), the times being in µs.
+// The threads are named with metadata events
+//
+bool Trace::write(const QString& fileName)
+{
+    QMutexLocker Locker(&BuffersMutex);
+    QJsonArray   Events;
+    qint64       Overwritten = 0;
+
+    for (const std::unique_ptr<TraceBuffer>& Buffer : Buffers) {
+        QJsonObject Arguments;
+        Arguments.insert("name", Buffer->Name);
+        QJsonObject Metadata;
+        Metadata.insert("name", "thread_name");
+        Metadata.insert("ph", "M");
+        Metadata.insert("pid", 1);
+        Metadata.insert("tid", Buffer->Id);
+        Metadata.insert("args", Arguments);
+        Events.append(Metadata);
+
+        quint64 First = Buffer->Count > TRACE_BUFFER_SIZE ? Buffer->Count - TRACE_BUFFER_SIZE : 0;
+        Overwritten += static_cast<qint64>(First);
+        for (quint64 i = First; i < Buffer->Count; i++) {
+            const TraceEvent& Event = Buffer->Events[i % TRACE_BUFFER_SIZE];
+            QJsonObject       Object;
+            Object.insert("name", Event.Name);
+            Object.insert("cat", "tbi");
+            Object.insert("ph", "X");
+            Object.insert("ts", Event.Start / 1000.0);
+            Object.insert("dur", (Event.End - Event.Start) / 1000.0);
+            Object.insert("pid", 1);
+            Object.insert("tid", Buffer->Id);
+            Events.append(Object);
+        }
+    }
+
+    QJsonObject Other;
+    Other.insert("overwrittenEvents", Overwritten);
+    QJsonObject Root;
+    Root.insert("traceEvents", Events);
+    Root.insert("displayTimeUnit", "ms");
+    Root.insert("otherData", Other);
+
+    QSaveFile  File(fileName);
+    QByteArray Json = QJsonDocument(Root).toJson(QJsonDocument::Compact);
+    return File.open(QIODevice::WriteOnly) && (File.write(Json) == Json.size()) && File.commit();
+}
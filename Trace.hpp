@@ -0,0 +1,89 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+//  Trace
+//
+// Lightweight tracing of the time spent in the main steps of TBI, written in the Chrome trace event format
+// (chrome://tracing or ui.perfetto.dev). Tracing is disabled by default: a scope then costs a single test.
+// Each thread records its events in its own ring buffer, without any lock, which is reused by a later thread once it exits.
+// When a buffer is full, the oldest events are overwritten. The buffers are read when the trace is written, once the work is done
+//
+class Trace
+{
+  public:
+    static void   enable();
+    static bool   isEnabled() { return Enabled.load(std::memory_order_relaxed); }
+    static void   setThreadName(const QString& name);
+    static qint64 now();
+    static void   record(const char* name, qint64 start, qint64 end);
+    static bool   write(const QString& fileName);
+
+  private:
+    static std::atomic<bool> Enabled;
+};
+
+//  TraceScope
+//
+// Record the time spent between its creation and its destruction, or the call to end().
+// The name must be a string literal
+//
+class TraceScope
+{
+  public:
+    TraceScope(const char* name)
+        : Name(name)
+        , Start(Trace::isEnabled() ? Trace::now() : -1)
+    {
+    }
+
+    ~TraceScope() { end(); }
+
+    void end()
+    {
+        if (this->Start >= 0) {
+            Trace::record(this->Name, this->Start, Trace::now());
+            this->Start = -1;
+        }
+    }
+
+  private:
+    Q_DISABLE_COPY(TraceScope)
+
+    const char* Name;
+    qint64      Start;
+};
+
+// Trace the rest of the current block
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)   TraceScope TRACE_CONCAT(TraceScope, __LINE__)(name)
+
+// Number of events kept by each thread
+#define TRACE_BUFFER_SIZE 65536
+
+#endif // TRACE_HPP
@@ -23,6 +23,8 @@
 #include "Global.hpp"
 #include "Settings.hpp"
 #include "ui_DlgSettings.h"
+#include <QDir>
+#include <QFileDialog>
 #include <QPushButton>
 
 DlgSettings::DlgSettings(QWidget* parent)
@@ -48,6 +50,12 @@ DlgSettings::DlgSettings(QWidget* parent)
         Settings::instance()->resetBaseURLTechnicalPublications();
         ui->EditTechPubUrl->setText(Settings::instance()->baseURLTechnicalPublications());
     });
+    connect(ui->ButtonBrowseInbox, &QPushButton::clicked, this, [this]() {
+        QString Directory = QFileDialog::getExistingDirectory(this, tr("Mail inbox"), ui->EditInboxDirectory->text());
+        if (!Directory.isEmpty()) {
+            ui->EditInboxDirectory->setText(QDir::toNativeSeparators(Directory));
+        }
+    });
 
     // Fill UI
     ui->EditTBwebpageUrl->setText(Settings::instance()->baseURLTechnicalBulletinWebpage());
@@ -65,6 +73,7 @@ DlgSettings::DlgSettings(QWidget* parent)
     ui->CheckSearchReplaces->setChecked(Settings::instance()->searchReplacesEnabled());
     ui->CheckSearchReplacedBy->setChecked(Settings::instance()->searchReplacedByEnabled());
     ui->CheckSearchNotes->setChecked(Settings::instance()->searchCommentEnabled());
+    ui->EditInboxDirectory->setText(QDir::toNativeSeparators(Settings::instance()->inboxDirectory()));
 }
 
 DlgSettings::~DlgSettings()
@@ -94,21 +103,26 @@ bool DlgSettings::showDlgSettings(QWidget* parent)
     // Execute the dialog
     // Save the settings if it was accepted
     if (Dlg->exec() == QDialog::Accepted) {
-        Settings::instance()->setBaseURLTechnicalPublications(Dlg->ui->EditTechPubUrl->text());
-        Settings::instance()->setBaseURLTechnicalBulletinPDF(Dlg->ui->EditTBpdfUrl->text());
-        Settings::instance()->setBaseURLTechnicalBulletinWepbage(Dlg->ui->EditTBwebpageUrl->text());
-        Settings::instance()->setRealTimeSearchEnabled(Dlg->ui->CheckRTSearch->isChecked());
-        Settings::instance()->setWholeWordsOnlyEnabled(Dlg->ui->CheckWholeWordsOnly->isChecked());
-        Settings::instance()->setSearchNumber(Dlg->ui->CheckSearchNumber->isChecked());
-        Settings::instance()->setSearchTitle(Dlg->ui->CheckSearchTitle->isChecked());
-        Settings::instance()->setSearchCategory(Dlg->ui->CheckSearchCategory->isChecked());
-        Settings::instance()->setSearchRK(Dlg->ui->CheckSearchRK->isChecked());
-        Settings::instance()->setSearchTechPub(Dlg->ui->CheckSearchTechPub->isChecked());
-        Settings::instance()->setSearchReleaseDate(Dlg->ui->CheckSearchReleaseDate->isChecked());
-        Settings::instance()->setSearchRegisteredBy(Dlg->ui->CheckSearchRegisteredBy->isChecked());
-        Settings::instance()->setSearchReplaces(Dlg->ui->CheckSearchReplaces->isChecked());
-        Settings::instance()->setSearchReplacedBy(Dlg->ui->CheckSearchReplacedBy->isChecked());
-        Settings::instance()->setSearchComment(Dlg->ui->CheckSearchNotes->isChecked());
+        SettingsSnapshot Snapshot                = Settings::instance()->snapshot();
+        Snapshot.BaseURLTechnicalPublications    = Dlg->ui->EditTechPubUrl->text();
+        Snapshot.BaseURLTechnicalBulletinPDF     = Dlg->ui->EditTBpdfUrl->text();
+        Snapshot.BaseURLTechnicalBulletinWebpage = Dlg->ui->EditTBwebpageUrl->text();
+        Snapshot.RealTimeSearch                  = Dlg->ui->CheckRTSearch->isChecked();
+        Snapshot.WholeWordsOnly                  = Dlg->ui->CheckWholeWordsOnly->isChecked();
+        Snapshot.SearchNumber                    = Dlg->ui->CheckSearchNumber->isChecked();
+        Snapshot.SearchTitle                     = Dlg->ui->CheckSearchTitle->isChecked();
+        Snapshot.SearchCategory                  = Dlg->ui->CheckSearchCategory->isChecked();
+        Snapshot.SearchRK                        = Dlg->ui->CheckSearchRK->isChecked();
+        Snapshot.SearchTechPub                   = Dlg->ui->CheckSearchTechPub->isChecked();
+        Snapshot.SearchReleaseDate               = Dlg->ui->CheckSearchReleaseDate->isChecked();
+        Snapshot.SearchRegisteredBy              = Dlg->ui->CheckSearchRegisteredBy->isChecked();
+        Snapshot.SearchReplaces                  = Dlg->ui->CheckSearchReplaces->isChecked();
+        Snapshot.SearchReplacedBy                = Dlg->ui->CheckSearchReplacedBy->isChecked();
+        Snapshot.SearchComment                   = Dlg->ui->CheckSearchNotes->isChecked();
+        Snapshot.InboxDirectory                  = QDir::fromNativeSeparators(Dlg->ui->EditInboxDirectory->text().trimmed());
+
+        // Publish all the settings at once
+        Settings::instance()->setSnapshot(Snapshot);
 
         // We return true if search conditions have changed
         SearchChanged = (OrgNumber != Dlg->ui->CheckSearchNumber->isChecked()) || (OrgTitle != Dlg->ui->CheckSearchTitle->isChecked())
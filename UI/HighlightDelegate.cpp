@@ -0,0 +1,153 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "HighlightDelegate.hpp"
+#include "TBTableModel.hpp"
+#include <QApplication>
+#include <QFontMetrics>
+#include <QStyle>
+#include <algorithm>
+#include <iterator>
+
+// Field displayed in each column. The release date is displayed in another format than the searched one,
+// it is never highlighted
+static const int ColumnFields[] = {
+    FIELD_NUMBER,
+    FIELD_TITLE,
+    FIELD_CATEGORY,
+    FIELD_RK,
+    FIELD_TECH_PUB,
+    -1,
+    FIELD_REGISTERED_BY,
+    FIELD_REPLACES,
+    FIELD_REPLACED_BY,
+    FIELD_KEYWORDS,
+};
+
+HighlightDelegate::HighlightDelegate(ThreadIndex* index, QObject* parent)
+    : QStyledItemDelegate(parent)
+    , Index(index)
+    , Fields(0)
+    , WholeWords(false)
+    , Generation(0)
+{
+}
+
+//  setQuery
+//
+// Set the query whose matches are highlighted. The cached spans are dropped if it changed
+//
+void HighlightDelegate::setQuery(const QString& query, quint32 fields, bool wholeWords)
+{
+    if ((query != this->Query) || (fields != this->Fields) || (wholeWords != this->WholeWords)) {
+        this->Query      = query;
+        this->Fields     = fields;
+        this->WholeWords = wholeWords;
+        this->Spans.clear();
+    }
+}
+
+//  cellSpans
+//
+// Return the match spans of a cell, computing the ones of its TB if they are not cached
+//
+QList<MatchSpan> HighlightDelegate::cellSpans(const QModelIndex& index) const
+{
+    QList<MatchSpan> Spans;
+    if (this->Query.isEmpty() || (index.column() >= static_cast<int>(std::size(ColumnFields))) || (ColumnFields[index.column()] == -1)) {
+        return Spans;
+    }
+
+    // The index was modified since the spans were computed
+    if (this->Generation != this->Index->generation()) {
+        this->Spans.clear();
+        this->Generation = this->Index->generation();
+    }
+
+    qint32 Id    = index.data(TB_ID_ROLE).toInt();
+    auto   Entry = this->Spans.constFind(Id);
+    if (Entry == this->Spans.constEnd()) {
+        Entry = this->Spans.insert(Id, this->Index->matchSpans(Id, this->Query, this->Fields, this->WholeWords));
+    }
+
+    for (int i = 0; i < Entry->count(); i++) {
+        if (Entry->at(i).Field == ColumnFields[index.column()]) {
+            Spans << Entry->at(i);
+        }
+    }
+    return Spans;
+}
+
+//  paint
+//
+// Paint the cell background with the style, then the highlights, then the text
+//
+void HighlightDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    QList<MatchSpan> Spans = cellSpans(index);
+    if (Spans.isEmpty()) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    QStyleOptionViewItem Option(option);
+    initStyleOption(&Option, index);
+    QString Text = Option.text;
+    Option.text.clear();
+
+    const QWidget* Widget = Option.widget;
+    QStyle*        Style  = Widget != nullptr ? Widget->style() : QApplication::style();
+    Style->drawControl(QStyle::CE_ItemViewItem, &Option, painter, Widget);
+
+    // Same text margins as the default rendering
+    QRect TextRect = Style->subElementRect(QStyle::SE_ItemViewItemText, &Option, Widget);
+    int   Margin   = Style->pixelMetric(QStyle::PM_FocusFrameHMargin, nullptr, Widget) + 1;
+    TextRect.adjust(Margin, 0, -Margin, 0);
+
+    painter->save();
+    painter->setClipRect(TextRect);
+    painter->setFont(Option.font);
+
+    // The highlights are measured on the text actually drawn: spans beyond the ellipsis are dropped or clamped
+    QFontMetrics Metrics(Option.font);
+    QString      Elided  = Metrics.elidedText(Text, Option.textElideMode, TextRect.width());
+    QRect        Drawn   = Metrics.boundingRect(TextRect, Option.displayAlignment, Elided);
+    int          Visible = 0; // Length of the text drawn before the ellipsis, if any
+    while ((Visible < Elided.length()) && (Visible < Text.length()) && (Elided.at(Visible) == Text.at(Visible))) {
+        Visible++;
+    }
+
+    for (int i = 0; i < Spans.count(); i++) {
+        int Offset = Spans.at(i).Offset;
+        if (Offset >= Visible) {
+            continue;
+        }
+        int Length = std::min(Spans.at(i).Length, Visible - Offset);
+        int Left   = Drawn.left() + Metrics.horizontalAdvance(Elided.left(Offset));
+        int Width  = Metrics.horizontalAdvance(Elided.mid(Offset, Length));
+        painter->fillRect(QRect(Left, TextRect.top(), Width, TextRect.height()), HIGHLIGHT_COLOR);
+    }
+
+    QPalette::ColorRole Role = Option.state & QStyle::State_Selected ? QPalette::HighlightedText : QPalette::Text;
+    painter->setPen(Option.palette.color(Role));
+    painter->drawText(TextRect, Option.displayAlignment, Elided);
+    painter->restore();
+}
@@ -0,0 +1,63 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef HIGHLIGHTDELEGATE_HPP
+#define HIGHLIGHTDELEGATE_HPP
+
+#include "../Index/ThreadIndex.hpp"
+#include <QHash>
+#include <QList>
+#include <QModelIndex>
+#include <QPainter>
+#include <QString>
+#include <QStyleOptionViewItem>
+#include <QStyledItemDelegate>
+
+//  HighlightDelegate
+//
+// Draw the cells of the TB table, highlighting the parts which match the current search.
+// The match spans of a TB are computed the first time one of its cells is painted, then cached
+// until the query or the index changes. Hidden and off-screen rows are never painted, so they cost nothing
+//
+class HighlightDelegate: public QStyledItemDelegate
+{
+  public:
+    HighlightDelegate(ThreadIndex* index, QObject* parent);
+    void setQuery(const QString& query, quint32 fields, bool wholeWords);
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+
+  private:
+    ThreadIndex* Index;
+    QString      Query;
+    quint32      Fields;
+    bool         WholeWords;
+
+    // Span cache, by TB id
+    mutable QHash<qint32, QList<MatchSpan>> Spans;
+    mutable quint64                         Generation;
+
+    QList<MatchSpan> cellSpans(const QModelIndex& index) const;
+};
+
+// Background color of the matching text
+#define HIGHLIGHT_COLOR QColor(255, 210, 0, 140)
+
+#endif // HIGHLIGHTDELEGATE_HPP
@@ -0,0 +1,116 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "KeywordCompleter.hpp"
+#include "../Index/Query.hpp"
+#include "Global.hpp"
+#include <QAbstractItemView>
+
+KeywordCompleter::KeywordCompleter(QLineEdit* edit)
+    : QCompleter(edit)
+    , Edit(edit)
+    , Index(nullptr)
+    , Model(new QStringListModel(this))
+    , SearchFields(FIELD_MASK(FIELD_KEYWORDS))
+{
+    // The widget is not given the completer with QLineEdit::setCompleter(),
+    // because the line edit would replace its whole text with the suggestion
+    setWidget(edit);
+    setModel(this->Model);
+    setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    setMaxVisibleItems(COMPLETER_MAX_SUGGESTIONS);
+
+    // Only user input triggers the popup, not the text set by the completer itself
+    connect(edit, &QLineEdit::textEdited, this, [this]() { updateSuggestions(); });
+    connect(this, qOverload<const QString&>(&QCompleter::activated), this, [this](const QString& suggestion) { insertSuggestion(suggestion); });
+}
+
+//  currentWord
+//
+// Return the word being typed, ie. the one ending at the cursor position.
+// The query syntax preceding it (negation, parenthesis, field name) is skipped
+//
+QString KeywordCompleter::currentWord(int* start, quint32* fields) const
+{
+    int      Cursor = this->Edit->cursorPosition();
+    QString  Text   = this->Edit->text().left(Cursor);
+    int      Start  = Text.lastIndexOf(KEYWORD_SEPARATOR) + 1;
+    quint32  Fields = this->SearchFields;
+    TB_FIELD Field;
+
+    while ((Start < Text.length()) && ((Text.at(Start) == QUERY_NOT_PREFIX) || (Text.at(Start) == '('))) {
+        Start++;
+    }
+
+    int Separator = Text.indexOf(QUERY_FIELD_SEPARATOR, Start);
+    if ((Separator != -1) && Query::fieldFromName(Text.mid(Start, Separator - Start), &Field)) {
+        Fields = FIELD_MASK(Field);
+        Start  = Separator + 1;
+    }
+
+    if (start != nullptr) {
+        *start = Start;
+    }
+    if (fields != nullptr) {
+        *fields = Fields;
+    }
+    return Text.mid(Start);
+}
+
+//  updateSuggestions
+//
+// Ask the term dictionary for the words beginning like the current one.
+// Nothing is displayed until the index is available
+//
+void KeywordCompleter::updateSuggestions()
+{
+    quint32 Fields;
+    QString Word = currentWord(nullptr, &Fields);
+    if ((this->Index == nullptr) || Word.isEmpty()) {
+        popup()->hide();
+        return;
+    }
+
+    QStringList Suggestions = this->Index->suggestions(Word, Fields, COMPLETER_MAX_SUGGESTIONS);
+    if (Suggestions.isEmpty()) {
+        popup()->hide();
+        return;
+    }
+
+    this->Model->setStringList(Suggestions);
+    complete();
+}
+
+//  insertSuggestion
+//
+// Replace the current word with the selected suggestion, then add a separator to type the next one
+//
+void KeywordCompleter::insertSuggestion(const QString& suggestion)
+{
+    int     Start;
+    QString Word        = currentWord(&Start);
+    QString Replacement = suggestion + KEYWORD_SEPARATOR;
+    QString Text        = this->Edit->text();
+
+    Text.replace(Start, Word.length(), Replacement);
+    this->Edit->setText(Text);
+    this->Edit->setCursorPosition(Start + Replacement.length());
+}
@@ -0,0 +1,59 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef KEYWORDCOMPLETER_HPP
+#define KEYWORDCOMPLETER_HPP
+
+#include "../Index/ThreadIndex.hpp"
+#include <QCompleter>
+#include <QLineEdit>
+#include <QString>
+#include <QStringListModel>
+
+//  KeywordCompleter
+//
+// Popup offering to complete the word being typed in the search field.
+// Suggestions come from the term dictionary of the index, the most frequent first.
+// Only the word at the cursor is completed, the other ones are left untouched.
+// If the word is qualified by a field name (eg. title:val), only this field is used
+//
+class KeywordCompleter: public QCompleter
+{
+  public:
+    KeywordCompleter(QLineEdit* edit);
+    void setIndex(ThreadIndex* index) { this->Index = index; }
+    void setSearchFields(quint32 fields) { this->SearchFields = fields; }
+
+  private:
+    QLineEdit*        Edit;
+    ThreadIndex*      Index;
+    QStringListModel* Model;
+    quint32           SearchFields;
+
+    QString currentWord(int* start = nullptr, quint32* fields = nullptr) const;
+    void    updateSuggestions();
+    void    insertSuggestion(const QString& suggestion);
+};
+
+// Max number of words displayed in the popup
+#define COMPLETER_MAX_SUGGESTIONS 10
+
+#endif // KEYWORDCOMPLETER_HPP
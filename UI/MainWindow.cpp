@@ -20,6 +20,8 @@
  */
 
 #include "MainWindow.hpp"
+#include "../Index/MailImporter.hpp"
+#include "../Index/TBExporter.hpp"
 #include "../Index/TechnicalBulletin.hpp"
 #include "DlgHelp.hpp"
 #include "DlgSettings.hpp"
@@ -27,49 +29,85 @@
 #include "DownloadMenu.hpp"
 #include "Global.hpp"
 #include "Settings.hpp"
+#include "Trace.hpp"
 #include "ui_MainWindow.h"
 #include <QAbstractButton>
+#include <QApplication>
 #include <QAbstractScrollArea>
+#include <QBitArray>
 #include <QClipboard>
 #include <QCursor>
 #include <QDataStream>
 #include <QDesktopServices>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileDialog>
 #include <QFileInfo>
 #include <QGuiApplication>
+#include <QInputDialog>
 #include <QKeySequence>
 #include <QLineEdit>
 #include <QList>
 #include <QMenu>
 #include <QMessageBox>
 #include <QMimeData>
+#include <QProgressDialog>
 #include <QPushButton>
+#include <QSet>
+#include <QSharedPointer>
 #include <QShortcut>
 #include <QStatusBar>
-#include <QTableWidget>
-#include <QTableWidgetItem>
+#include <QItemSelectionModel>
+#include <QTableView>
+#include <QTextStream>
 #include <QTimer>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrentRun>
+#include <limits>
 
-MainWindow::MainWindow(bool ForceIndexCheck)
+MainWindow::MainWindow(bool ForceIndexCheck, bool MemoryReportOnOpening)
     : QMainWindow()
     , ui(new Ui::MainWindow)
-    , Index(new ThreadIndex(this, ForceIndexCheck))
+    , Index(new ThreadIndex(ForceIndexCheck, TBI_FILENAME))
+    , Model(new TBTableModel(Index, this))
     , SaveInProgress(false)
     , MessageTBCount(new QLabel)
     , MessagePendingModifications(new QLabel)
+    , MessageInbox(new QLabel)
     , TableContextMenu(new QMenu(this))
     , ActionNewTB(new ContextMenuAction(tr("New TB"), this, QKeySequence(Qt::CTRL | Qt::Key_N)))
     , ActionEditTB(new ContextMenuAction(tr("Edit TB"), this, QKeySequence(Qt::CTRL | Qt::Key_E)))
     , ActionDeleteTB(new ContextMenuAction(tr("Delete TB"), this, QKeySequence(Qt::Key_Delete)))
+    , ActionImportMails(new ContextMenuAction(tr("Import mails"), this, QKeySequence(Qt::CTRL | Qt::Key_I)))
+    , ActionImportRecords(new ContextMenuAction(tr("Import CSV / JSON Lines"), this, QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_I)))
+    , ActionExport(new ContextMenuAction(tr("Export"), this, QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_E)))
     , ActionCopyUrl(new ContextMenuAction(tr("Copy URL"), this, QKeySequence(Qt::CTRL | Qt::Key_C)))
     , ActionOpenUrl(new ContextMenuAction(tr("Open URL"), this, QKeySequence(Qt::CTRL | Qt::Key_O)))
     , ActionDownload(new ContextMenuAction(tr("Download"), this))
     , ActionSettings(new ContextMenuAction(tr("Settings"), this))
     , ActionHelp(new ContextMenuAction(tr("Help / About"), this, QKeySequence(Qt::Key_F1)))
     , DLMenu(new DownloadMenu)
+    , Completer(nullptr)
+    , Highlighter(nullptr)
+    , IndexOpened(false)
+    , IndexOpeningFailed(false)
+    , SearchTimer(new QTimer(this))
+    , SearchLatency(0)
+    , TBDisplayed(false)
+    , PopulateTimer(new QTimer(this))
+    , ImportWatcher(nullptr)
+    , RecordWatcher(nullptr)
+    , RecordBatches(0)
+    , RecordsAdded(0)
+    , RecordsDuplicated(0)
+    , RecordsRejected(0)
+    , ExportWatcher(nullptr)
+    , InboxThread(new QThread(this))
+    , Inbox(new MailInbox)
     , FirstLogEntry(true)
     , TBreadFirst(true)
+    , MemoryReportOnOpening(MemoryReportOnOpening)
 {
     //==================================================================================================================
     //
@@ -87,18 +125,54 @@ MainWindow::MainWindow(bool ForceIndexCheck)
         save();
         updateUI();
     });
+*/
     connect(ui->ButtonSearch, &QPushButton::clicked, this, [this]() { search(); });
 
     // Search connections
-    connect(ui->EditKeywords, &QLineEdit::returnPressed, this, [this]() { search(); });
+    connect(ui->EditKeywords, &QLineEdit::returnPressed, this, [this]() {
+        this->SearchTimer->stop();
+        search();
+    });
     connect(ui->EditKeywords, &QLineEdit::textChanged, this, [this]() {
-        if (ui->EditKeywords->text().isEmpty() || Settings::instance()->realTimeSearchEnabled())
+        if (ui->EditKeywords->text().isEmpty()) {
+            this->SearchTimer->stop();
             search();
+        }
+        else if (Settings::instance()->realTimeSearchEnabled()) {
+            this->SearchTimer->start(searchDelay());
+        }
     });
-*/
+
+    // Real-time search debouncing
+    this->SearchTimer->setSingleShot(true);
+    connect(this->SearchTimer, &QTimer::timeout, this, [this]() { search(); });
+
+    // Search field completion, available once the index is opened
+    this->Completer = new KeywordCompleter(ui->EditKeywords);
+
+    // Matches highlighting
+    this->Highlighter = new HighlightDelegate(this->Index, this);
+    ui->TableTB->setItemDelegate(this->Highlighter);
+
+    // Progressive table population
+    this->PopulateTimer->setSingleShot(true);
+    this->PopulateTimer->setInterval(0);
+    connect(this->PopulateTimer, &QTimer::timeout, this, [this]() { populateStep(); });
+
+    // Settings changes
+    connect(Settings::instance(), &Settings::snapshotChanged, this, [this](const SettingsSnapshot& snapshot) { settingsChanged(snapshot); });
+
     // Status bar
     ui->StatusBar->addPermanentWidget(this->MessageTBCount);
     ui->StatusBar->addPermanentWidget(this->MessagePendingModifications);
+    ui->StatusBar->addPermanentWidget(this->MessageInbox);
+    this->MessageInbox->setVisible(false);
+
+    // Mail inbox, started when the index is opened
+    this->Inbox->moveToThread(this->InboxThread);
+    connect(this->InboxThread, &QThread::finished, this->Inbox, &QObject::deleteLater);
+    connect(this->Inbox, &MailInbox::mailsReceived, this, [this](const QList<InboxMail>& mails) { inboxMailsReceived(mails); });
+    this->InboxThread->start();
 
 
     //==================================================================================================================
@@ -116,6 +190,9 @@ MainWindow::MainWindow(bool ForceIndexCheck)
     //
     //==================================================================================================================
 
+    // Model
+    ui->TableTB->setModel(this->Model);
+
     // Settings
     ui->TableTB->setShowGrid(true);
     ui->TableTB->setSortingEnabled(true);
@@ -125,21 +202,23 @@ MainWindow::MainWindow(bool ForceIndexCheck)
     ui->TableTB->setSelectionBehavior(QAbstractItemView::SelectRows);
     ui->TableTB->verticalHeader()->setVisible(false);
     ui->TableTB->horizontalHeader()->setStretchLastSection(true);
-    /*
+
     // Connections
-    connect(ui->TableTB, &QTableWidget::itemSelectionChanged, this, [this]() { updateUI(); });
-    connect(ui->TableTB, &QTableWidget::cellDoubleClicked, this, [this]() {
-        editTB();
-        updateUI();
+    connect(ui->TableTB->selectionModel(), &QItemSelectionModel::selectionChanged, this, [this]() { updateUI(); });
+    connect(ui->TableTB, &QTableView::doubleClicked, this, [this]() {
+        if (this->IndexOpened) {
+            editTB();
+            updateUI();
+        }
     });
-*/
+
 
     //==================================================================================================================
     //
     //      Context menu
     //
     //==================================================================================================================
-    /*
+
     // TB table context menu
     ui->TableTB->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui->TableTB, &QWidget::customContextMenuRequested, this, [this]() { this->TableContextMenu->exec(QCursor::pos()); });
@@ -149,6 +228,13 @@ MainWindow::MainWindow(bool ForceIndexCheck)
         deleteTB();
         updateUI();
     });
+    connect(this->ActionImportMails, &QAction::triggered, this, [this]() {
+        importMails(QFileDialog::getOpenFileNames(this, tr("Import mails"), QString(), tr("Mails (*.eml *.mbox *.mbx *.txt);;All files (*)")));
+    });
+    connect(this->ActionImportRecords, &QAction::triggered, this, [this]() {
+        importRecords(QFileDialog::getOpenFileName(this, tr("Import CSV / JSON Lines"), QString(), tr("Records (*.csv *.jsonl);;All files (*)")));
+    });
+    connect(this->ActionExport, &QAction::triggered, this, [this]() { exportTB(); });
     connect(this->ActionCopyUrl, &QAction::triggered, this, [this]() { copyURLToClipboard(); });
     connect(this->ActionOpenUrl, &QAction::triggered, this, [this]() { openURL(); });
     connect(this->ActionSettings, &QAction::triggered, this, [this]() {
@@ -161,25 +247,36 @@ MainWindow::MainWindow(bool ForceIndexCheck)
 
     // Add actions to the context menu and to the main window to allow kbd shortcuts
     QList<QAction*> Actions;
-    Actions << this->ActionNewTB << this->ActionEditTB << this->ActionDeleteTB << this->ActionCopyUrl << this->ActionOpenUrl << this->ActionDownload << this->ActionSettings
+    Actions << this->ActionNewTB << this->ActionEditTB << this->ActionDeleteTB << this->ActionImportMails << this->ActionImportRecords << this->ActionExport << this->ActionCopyUrl << this->ActionOpenUrl << this->ActionDownload << this->ActionSettings
             << this->ActionHelp;
     this->TableContextMenu->addActions(Actions);
     this->TableContextMenu->insertSeparator(this->ActionCopyUrl);
     this->TableContextMenu->insertSeparator(this->ActionSettings);
     this->addActions(Actions);
-*/
 
     //==================================================================================================================
     //
     //      Keyboard shortcuts
     //
     //==================================================================================================================
-    /*
+
     // Paste
     connect(new QShortcut(QKeySequence(QKeySequence::Paste), this), &QShortcut::activated, this, [this]() { paste(); });
-*/
+
     // Search
     connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_F), this), &QShortcut::activated, this, [this]() { ui->EditKeywords->setFocus(); });
+
+    // Jump to a TB number
+    connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_J), this), &QShortcut::activated, this, [this]() { jumpToTB(); });
+
+    // Review the mails of the inbox
+    connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_R), this), &QShortcut::activated, this, [this]() { reviewInbox(); });
+
+    // Remove the obsolete TB
+    connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_U), this), &QShortcut::activated, this, [this]() { resolveObsoleteTB(); });
+
+    // Memory used by the index
+    connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_M), this), &QShortcut::activated, this, [this]() { logMemoryReport(); });
     /*
     // Save
     connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_S), this), &QShortcut::activated, this, [this]() {
@@ -215,13 +312,15 @@ MainWindow::MainWindow(bool ForceIndexCheck)
     connect(this->Index, &ThreadIndex::openingIndex, this, [this](qint32 version, qint32 count) { openingIndex(version, count); });
     connect(this->Index, &ThreadIndex::tbRead, this, [this](int count) { tbRead(count); });
     connect(this->Index, &ThreadIndex::indexOpenedSuccessfully, this, [this](qint32 count) { indexOpenedSuccessfully(count); });
+    connect(this->Index, &ThreadIndex::tbAvailable, this, [this](int count) { tbAvailable(count); });
     connect(this->Index, &ThreadIndex::noIndexFound, this, [this]() { noIndexFound(); });
     connect(this->Index, &ThreadIndex::failedToOpenIndex, this, [this]() { failedToOpenIndex(); });
     connect(this->Index, &ThreadIndex::invalidIndexIdentifier, this, [this](QString magic) { invalidIndexIdentifier(magic); });
     connect(this->Index, &ThreadIndex::indexTooRecent, this, [this](qint32 version) { indexTooRecent(version); });
     connect(this->Index, &ThreadIndex::indexReadingFailed, this, [this](int count) { indexReadingFailed(count); });
-    //    connect(this->Index, &ThreadIndex::openingComplete, this, [this]() { openingComplete(); });
+    connect(this->Index, &ThreadIndex::openingComplete, this, [this]() { openingComplete(); });
     connect(this->Index, &ThreadIndex::saveComplete, this, [this](int result) { saveComplete(result); });
+    connect(this, &MainWindow::save, this->Index, [this](bool backup) { this->Index->save(backup); });
 }
 
 MainWindow::~MainWindow()
@@ -236,6 +335,15 @@ MainWindow::~MainWindow()
     // Destroy the index
     //Index::release();
 
+    // Stop the inbox, the mails waiting for a review are left in it
+    this->InboxThread->quit();
+    this->InboxThread->wait();
+
+    // The loading may still run. It is waited for only when tracing, so that the trace can be written safely
+    if (Trace::isEnabled()) {
+        this->Index->wait();
+    }
+
     // UI
     delete this->DLMenu;
     delete ui;
@@ -272,6 +380,21 @@ void MainWindow::addLogText(QString text)
     ui->TextLog->insertPlainText(text);
 }
 
+//  logMemoryReport
+//
+// Display the memory used by the index and by the table in the log, and return the report
+//
+QString MainWindow::logMemoryReport()
+{
+    MemoryReport Report = this->Index->memoryReport();
+    Report.addSubsystem("Table model", this->Model->memoryUsage());
+
+    QString Text = Report.text();
+    addLogEntry("Memory report\n");
+    addLogText(Text);
+    return Text;
+}
+
 void MainWindow::startLogTimer()
 {
     this->LogTimer = QTime::currentTime();
@@ -318,8 +441,25 @@ void MainWindow::indexOpenedSuccessfully(qint32 count)
 {
     addLogEntry(QString("Index file successfully opened, %1 Technical Bulletins parsed").arg(count));
     addLogTimer();
-    populateUI();
-    toggleStackCentral();
+    int BrokenChains = this->Index->brokenChains().count();
+    if (BrokenChains != 0) {
+        addLogEntry(QString("%1 Technical Bulletins reference a replaced or replacing TB missing from the index").arg(BrokenChains));
+    }
+    finishPopulating();
+    indexReady();
+}
+
+//  indexReady
+//
+// Enable the search and the edition, once the structures of the index are installed
+//
+void MainWindow::indexReady()
+{
+    this->IndexOpened = true;
+    this->Completer->setSearchFields(Settings::instance()->snapshot().searchFields());
+    this->Completer->setIndex(this->Index);
+    setInboxDirectory(Settings::instance()->inboxDirectory());
+    updateUI();
 }
 
 void MainWindow::noIndexFound()
@@ -330,6 +470,7 @@ void MainWindow::noIndexFound()
 
 void MainWindow::failedToOpenIndex()
 {
+    this->IndexOpeningFailed = true;
     addLogEntry("Failed to open index, QFile::open(QIODevice::ReadOnly) failed");
     QString Message = QString("Failed to open the file %1%2%3.").arg(QDir::toNativeSeparators(QDir::currentPath())).arg(QDir::separator()).arg(TBI_FILENAME);
     QMessageBox::critical(this, "Index opening error", Message);
@@ -338,6 +479,7 @@ void MainWindow::failedToOpenIndex()
 
 void MainWindow::invalidIndexIdentifier(QString magic)
 {
+    this->IndexOpeningFailed = true;
     addLogEntry(QString("Invalid magic: found '%1' instead of '%2'").arg(magic, TBI_MAGIC));
     QString Message("Invalid index identifier. Your index is probably corrupted.");
     QMessageBox::critical(this, "Index opening error", Message);
@@ -346,6 +488,7 @@ void MainWindow::invalidIndexIdentifier(QString magic)
 
 void MainWindow::indexTooRecent(qint32 version)
 {
+    this->IndexOpeningFailed = true;
     addLogEntry(QString("Tried to open an index version %1. Max openable version: %2").arg(version, CURRENT_TBI_VERSION));
     QString Message("Your executable is too old to open this index, please use a more recent version.");
     QMessageBox::critical(this, "Index opening error", Message);
@@ -354,6 +497,7 @@ void MainWindow::indexTooRecent(qint32 version)
 
 void MainWindow::indexReadingFailed(int count)
 {
+    this->IndexOpeningFailed = true;
     addLogEntry(QString("Failure while reading the index. %1 Technical Bulletins were successfully opened").arg(count));
     QString Message = QString("Failure while reading the index. %1 Technical Bulletins could be opened. Do you want to save them and lose definitively the others?").arg(count);
 
@@ -362,14 +506,97 @@ void MainWindow::indexReadingFailed(int count)
         addLogEntry("Requesting to save the index after opening failure");
         this->SaveInProgress = true;
         emit save(BACKUP_ON_SAVE);
-        populateUI();
-        toggleStackCentral();
+        finishPopulating();
+        indexReady();
+    }
+
+    // The partially loaded TB were already displayed, go back to the log
+    else if (this->TBDisplayed) {
+        this->PopulateTimer->stop();
+        this->TBDisplayed = false;
+        ui->StackCentral->setCurrentWidget(ui->PageLog);
+    }
+}
+
+//  tbAvailable
+//
+// Some TB were loaded. The first ones are displayed immediately, with the table,
+// the next ones are added by populateStep(), without blocking the UI
+//
+void MainWindow::tbAvailable(int count)
+{
+    if (!this->TBDisplayed) {
+        this->Model->appendLoaded(count);
+        this->TBDisplayed = true;
+        ui->StackCentral->setCurrentWidget(ui->PageTable);
+        addLogEntry(QString("First Technical Bulletins displayed"));
+        addLogTimer();
+    }
+    else if (!this->PopulateTimer->isActive()) {
+        this->PopulateTimer->start();
     }
 }
 
+//  populateStep
+//
+// Display the loaded TB by batches, until the time budget of a frame is spent.
+// The search is applied again if needed, so the rows added to the table are filtered too
+//
+void MainWindow::populateStep()
+{
+    TRACE_SCOPE("Populate step");
+    QElapsedTimer Timer;
+    Timer.start();
+
+    int Remaining;
+    do {
+        Remaining = this->Model->appendLoaded(POPULATE_BATCH_SIZE);
+    } while ((Remaining != 0) && (Timer.elapsed() < POPULATE_FRAME_BUDGET));
+
+    if (!this->CurrentQuery.isEmpty()) {
+        search(FORCE_SEARCH);
+    }
+    if (Remaining != 0) {
+        this->PopulateTimer->start();
+    }
+}
+
+//  finishPopulating
+//
+// Called when the index is loaded: display the last TB, then the table if nothing was displayed yet
+//
+void MainWindow::finishPopulating()
+{
+    TRACE_SCOPE("Finish populating");
+    this->PopulateTimer->stop();
+    this->Model->appendLoaded(std::numeric_limits<int>::max());
+    if (!this->CurrentQuery.isEmpty()) {
+        search(FORCE_SEARCH);
+    }
+    if (!this->TBDisplayed) {
+        this->TBDisplayed = true;
+        ui->StackCentral->setCurrentWidget(ui->PageTable);
+    }
+    addLogEntry("UI ready");
+    addLogTimer();
+}
+
+//  openingComplete
+//
+// Received after the structures of the index were installed. Without index file, or with an empty legacy one,
+// the index is ready but empty. Errors leave it disabled, so a damaged file is not overwritten
+//
 void MainWindow::openingComplete()
 {
-    // unused signal
+    if (!this->IndexOpened && !this->IndexOpeningFailed) {
+        addLogEntry("Starting with an empty index");
+        indexReady();
+    }
+
+    // --memory-report: the report is also written on the standard output
+    if (this->MemoryReportOnOpening) {
+        QTextStream(stdout) << logMemoryReport();
+    }
 }
 
 void MainWindow::saveComplete(int result)
@@ -415,406 +642,343 @@ void MainWindow::populateUI()
 {
     startLogTimer();
     addLogEntry(QString("Populating UI, please wait..."));
-    QList<TechnicalBulletin*> Bulletins = this->Index->tbList();
-
-    ui->TableTB->setSortingEnabled(false); // Disable sorting to prevent a null-pointer dereferencing
-    ui->TableTB->setRowCount(Bulletins.count());
-
-    for (int i = 0; i < Bulletins.count(); i++) {
-        for (int j = 0; j < ui->TableTB->columnCount(); j++) {
-            ui->TableTB->setItem(i, j, new QTableWidgetItem);
-        }
-        updateTB(Bulletins.at(i), i);
-    }
-
-    ui->TableTB->setSortingEnabled(true);
-    QTableWidgetItem* Item = ui->TableTB->item(Bulletins.count(), 0);
-    ui->TableTB->setCurrentItem(Item);
-    ui->TableTB->scrollToItem(Item);
+    this->Model->reset();
+    ui->TableTB->scrollToBottom();
     addLogEntry("UI ready");
     addLogTimer();
 }
 
-/*    // Update table size
-    int RowCount = ui->TableTB->rowCount();
-    ui->TableTB->setRowCount(RowCount + 1);
-    
-    // Populate the new line with empty items
-    for (int i = 0; i < ui->TableTB->columnCount(); i++) {
-        ui->TableTB->setItem(RowCount, i, new QTableWidgetItem);
-    }
-    
-    // Save an item ptr to make the last entry become the current one
-    QTableWidgetItem* Item = ui->TableTB->item(RowCount, 0);
-    
-    // Display new TB in the new line
-    updateTB(tb, RowCount);
-    
-    // Re-enable table sorting, set the TB as the current one and display it
-    ui->TableTB->setSortingEnabled(true);
-    ui->TableTB->setCurrentItem(Item);
-    ui->TableTB->scrollToItem(Item);*/
-
 //  updateUI
 //
 // Adjust display according to index state
 //
-/*
 void MainWindow::updateUI()
 {
+    bool Modified = this->Index->isModified();
 
     // Window title
-    setWindowTitle(QString("%1 %2").arg(WINDOW_TITLE, this->Modified ? "- (modified)" : ""));
+    setWindowTitle(QString("%1 %2").arg(WINDOW_TITLE, Modified ? "- (modified)" : ""));
 
     // Button
-    ui->ButtonSave->setEnabled(this->Modified);
+    ui->ButtonSave->setEnabled(Modified);
     ui->ButtonSearch->setVisible(!Settings::instance()->realTimeSearchEnabled());
 
     // Status bar
-    int     Count  = ui->TableTB->rowCount();
+    int     Count  = this->Model->tbCount();
     QString Plural = Count > 1 ? "s" : "";
     this->MessageTBCount->setText(tr("%1 Technical Bulletin%2 registered").arg(Count).arg(Plural));
-    this->MessagePendingModifications->setText(this->Modified ? tr("Modifications pending") : tr("Index is saved"));
+    this->MessagePendingModifications->setText(Modified ? tr("Modifications pending") : tr("Index is saved"));
+    this->MessageInbox->setText(tr("%1 mail(s) to review (Ctrl-R)").arg(this->ReviewQueue.count()));
+    this->MessageInbox->setVisible(!this->ReviewQueue.isEmpty());
 
     // Actions (context menu)
-    bool ItemSelected = !ui->TableTB->selectedItems().isEmpty();
-    this->ActionEditTB->setEnabled(ItemSelected);
-    this->ActionDeleteTB->setEnabled(ItemSelected);
+    qint32 Id           = currentTB();
+    bool   ItemSelected = Id != INVALID_TB_ID;
+    this->ActionEditTB->setEnabled(ItemSelected && this->IndexOpened);
+    this->ActionDeleteTB->setEnabled(ItemSelected && this->IndexOpened);
     this->ActionCopyUrl->setEnabled(ItemSelected);
     this->ActionOpenUrl->setEnabled(ItemSelected);
 
     // Download action and sub-menu
     if (ItemSelected) {
-        int     Row       = ui->TableTB->currentRow();
-        QString DocsField = ui->TableTB->item(Row, COLUMN_TECH_PUB)->text();
-        QString TBnumberField = ui->TableTB->item(Row, COLUMN_NUMBER)->text().trimmed();
+        TechnicalBulletin* TB            = this->Index->tb(Id);
+        QString            DocsField     = TB->techpub();
+        QString            TBnumberField = TB->number().trimmed();
         this->DLMenu->setItems(DocsField, TBnumberField);
         this->ActionDownload->setMenu(this->DLMenu);
         this->ActionDownload->setDisabled(this->DLMenu->isEmpty());
     }
 }
-*/
-//  save
-//
-// Save current index
-//
-/*
-void MainWindow::save()
-{
-    // First, create a backup by renaming the current index
-    // Remove current backup because File::rename() won't overwrite backup file
-    QFile::remove(TBI_BACKUP_FILENAME);
-    if (!QFile::rename(TBI_FILENAME, TBI_BACKUP_FILENAME)) {
-        if (QMessageBox::question(this, WINDOW_TITLE, tr("Couldn't create index backup. Save anyway?")) == QMessageBox::No) {
-            return;
-        }
-    }
-
-    // Try to open the file
-    QFile File(TBI_FILENAME);
-    if (!File.open(QIODevice::WriteOnly)) {
-        QMessageBox::critical(this, WINDOW_TITLE, tr("Couldn't open file %1").arg(TBI_FILENAME));
-        return;
-    }
-
-    // Open a data stream and write into it
-    QDataStream Stream(&File);
-
-    // First, write 0 to support old DB
-    Stream << (qint32)0;
-
-    // Then write magic + current version
-    Stream << QString(TBI_MAGIC) << (qint32)CURRENT_TBI_VERSION;
 
-    // Write TB count
-    Stream << (qint32)(ui->TableTB->rowCount());
-
-    // Serialize TBs
-    for (int i = 0; i < ui->TableTB->rowCount(); i++) {
-        // Get TB ptr
-        TechnicalBulletin* TB = ui->TableTB->item(i, COLUMN_METADATA)->data(TB_ROLE).value<TechnicalBulletin*>();
-        Stream << *TB;
-
-        // Check stream status
-        if (Stream.status() != QDataStream::Ok) {
-            QMessageBox::critical(this, WINDOW_TITLE, tr("Failed to save file %1").arg(TBI_FILENAME));
-            return;
-        }
-    }
-
-    this->Modified = false;
-}
-*/
 //  newTB
 //
 // Open a dialog allowing to create a TB by hand
 //
-/*
 void MainWindow::newTB()
 {
+    if (!this->IndexOpened) {
+        return;
+    }
+
     TechnicalBulletin* TB = DlgTB::newDlgTB(this);
     if (TB != nullptr) {
-        this->Modified = true;
         addTB(TB, PERFORM_ADD_CHECKS);
         updateUI();
     }
 }
-*/
+
 //  editTB
 //
 // Open a dialog allowing to edit an existing TB
+// The dialog edits a copy, which replaces the TB in the index if the dialog is accepted
 //
-/*
 void MainWindow::editTB()
 {
+    // The loading thread still reads the TB until the index is opened
+    if (!this->IndexOpened) {
+        return;
+    }
+
     // Get current TB
-    QList<QTableWidgetItem*> Items = ui->TableTB->selectedItems();
-    int                      Row   = Items.at(0)->row();
-    TechnicalBulletin*       TB    = ui->TableTB->item(Row, COLUMN_METADATA)->data(TB_ROLE).value<TechnicalBulletin*>();
+    qint32 Id = currentTB();
+    if (Id == INVALID_TB_ID) {
+        return;
+    }
+    TechnicalBulletin TB(*this->Index->tb(Id));
 
     // Open edition dialog
-    if (DlgTB::editDlgTB(this, TB)) {
-        this->Modified = true;
-        updateTB(TB, Row);
+    if (DlgTB::editDlgTB(this, &TB)) {
+        this->Model->updateTB(Id, TB);
+        search(FORCE_SEARCH);
     }
 }
-*/
+
 //  deleteTB
 //
 // Delete the TB currently selected
 //
-/*
 void MainWindow::deleteTB()
 {
+    // The loading thread still reads the TB until the index is opened
+    if (!this->IndexOpened) {
+        return;
+    }
+
     // Get current TB
-    QList<QTableWidgetItem*> Selection = ui->TableTB->selectedItems();
-    int                      Row       = Selection.at(0)->row();
-    TechnicalBulletin*       TB        = ui->TableTB->item(Row, COLUMN_METADATA)->data(TB_ROLE).value<TechnicalBulletin*>();
+    qint32 Id = currentTB();
+    if (Id == INVALID_TB_ID) {
+        return;
+    }
+    TechnicalBulletin* TB = this->Index->tb(Id);
 
     // Show a confirmation dialog
     QMessageBox::StandardButton Answer = QMessageBox::question(this, WINDOW_TITLE, tr("Do you want to delete Technical Bulletin %1 (%2)?").arg(TB->number(), TB->title()));
     if (Answer == QMessageBox::Yes) {
-        delete TB;
-        ui->TableTB->removeRow(Row);
-
-        // Update UI
-        this->Modified = true;
+        this->Model->removeTB(Id);
     }
 }
-*/
+
 //  search
 //
-// Search the TB with keywords
+// Search the TB with a query (see Query.hpp for the syntax)
+// The index resolves the query, then the rows which don't match are hidden
 //
-/*
 void MainWindow::search(bool ForceNewSearch)
 {
-    // Split and clean the list
-    static QStringList Keywords;
-    QStringList        UIkeywords = ui->EditKeywords->text().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-    UIkeywords.removeDuplicates();
+    TRACE_SCOPE("Search (UI)");
+    // Nothing to search until the first TB are displayed. While the index is loading, the loaded TB are searched
+    if (!this->IndexOpened && !this->TBDisplayed) {
+        return;
+    }
+
+    // Clean the query
+    QString UIquery = ui->EditKeywords->text().simplified();
 
-    // Early return if the list didn't change and we don't force a new search
-    if ((UIkeywords == Keywords) && !ForceNewSearch) {
+    // Early return if the query didn't change and we don't force a new search.
+    // Switching back to a previous query is cheap, its result is cached by the index
+    if ((UIquery == this->CurrentQuery) && !ForceNewSearch) {
         return;
     }
-    Keywords = UIkeywords;
+    this->CurrentQuery = UIquery;
 
     // Display status bar message
     ui->StatusBar->showMessage(tr("Searching..."));
-
-    // Display all entries if there is no filter
-    if (Keywords.count() == 0) {
-        // No keyword: display all TBs
-        for (int i = 0; i < ui->TableTB->rowCount(); i++) {
-            ui->TableTB->setRowHidden(i, false);
-        }
+    QElapsedTimer Timer;
+    Timer.start();
+
+    // Empty query: all the TB are displayed
+    // Else the result is applied to the table at once, the model filtering the rows
+    const SettingsSnapshot& Snapshot = Settings::instance()->snapshot();
+    this->Highlighter->setQuery(this->CurrentQuery, Snapshot.searchFields(), Snapshot.WholeWordsOnly);
+    if (this->CurrentQuery.isEmpty()) {
+        this->Model->setFilter(QBitArray());
     }
     else {
-        // Else filter TBs with keywords
-        for (int i = 0; i < ui->TableTB->rowCount(); i++) {
-            TechnicalBulletin* TB         = ui->TableTB->item(i, COLUMN_METADATA)->data(TB_ROLE).value<TechnicalBulletin*>();
-            QStringList        TBkeywords = TB->keywords();
-
-            // Add some fields to the keyword list, depending on global configuration
-            if (Settings::instance()->searchNumberEnabled()) {
-                TBkeywords << TB->number().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-            }
-            if (Settings::instance()->searchTitleEnabled()) {
-                TBkeywords << TB->title().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-            }
-            if (Settings::instance()->searchCategoryEnabled()) {
-                TBkeywords << TB->category().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-            }
-            if (Settings::instance()->searchRKEnabled()) {
-                TBkeywords << TB->rk().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-            }
-            if (Settings::instance()->searchTechPubEnabled()) {
-                TBkeywords << TB->techpub().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-            }
-            if (Settings::instance()->searchReleaseDateEnabled()) {
-                TBkeywords << TB->releaseDate().toString().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-            }
-            if (Settings::instance()->searchRegisteredByEnabled()) {
-                TBkeywords << TB->registeredBy().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-            }
-            if (Settings::instance()->searchReplacesEnabled()) {
-                TBkeywords << TB->replaces().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-            }
-            if (Settings::instance()->searchReplacedByEnabled()) {
-                TBkeywords << TB->replacedBy().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-            }
-            if (Settings::instance()->searchCommentEnabled()) {
-                TBkeywords << TB->comment().split(KEYWORD_SEPARATOR, Qt::SkipEmptyParts);
-            }
+        this->Model->setFilter(this->Index->search(this->CurrentQuery, Snapshot.searchFields(), Snapshot.WholeWordsOnly));
+    }
 
-            // Default: current row must be shown
-            bool Hidden = false;
+    // Smoothed latency, used to debounce the next keystrokes
+    this->SearchLatency = this->SearchLatency * (1 - SEARCH_LATENCY_SMOOTHING) + Timer.elapsed() * SEARCH_LATENCY_SMOOTHING;
 
-            // Only exact matches are allowed
-            if (Settings::instance()->wholeWordsOnlyEnabled()) {
-                for (int j = 0; j < Keywords.count(); j++) {
-                    if (!TBkeywords.contains(Keywords[j], Qt::CaseInsensitive)) {
-                        Hidden = true;
-                        break;
-                    }
-                }
-            }
+    ui->StatusBar->clearMessage();
+}
 
-            // Partial matches are allowed
-            else {
-                int Match = 0;
-                for (int j = 0; j < Keywords.count(); j++) {
-                    for (int k = 0; k < TBkeywords.count(); k++) {
-                        if (TBkeywords.at(k).contains(Keywords[j], Qt::CaseInsensitive)) {
-                            Match++;
-                            break;
-                        }
-                    }
-                }
-                Hidden = Match < Keywords.count();
-            }
-            ui->TableTB->setRowHidden(i, Hidden);
-        }
+//  searchDelay
+//
+// Return the time to wait after a keystroke before searching in real time.
+// Fast searches are performed immediately. Slower ones wait for the user to pause,
+// so a search is not started for each keystroke of a word
+//
+int MainWindow::searchDelay() const
+{
+    if (this->SearchLatency < SEARCH_INSTANT_LATENCY) {
+        return 0;
     }
-    ui->StatusBar->clearMessage();
+    return qMin(static_cast<int>(this->SearchLatency * SEARCH_DELAY_FACTOR), SEARCH_MAX_DELAY);
 }
-*/
+
 //  addTB
 //
-// Add a TB at the bottom of the table
+// Add a TB to the index, then at the bottom of the table.
+// The index takes the ownership of the TB, which is deleted if the checks fail.
+// The checks use the number index, so they don't depend on the index size
 //
-/*
 void MainWindow::addTB(TechnicalBulletin* tb, bool PerformAddChecks)
 {
     if (PerformAddChecks) {
-        for (int i = 0; i < ui->TableTB->rowCount(); i++) {
-            TechnicalBulletin* CurrentTB = ui->TableTB->item(i, COLUMN_METADATA)->data(TB_ROLE).value<TechnicalBulletin*>();
+        // Check that the TB doesn't exist yet
+        // Don't allow to add twice the same TB
+        if (this->Index->findTB(tb->number()) != INVALID_TB_ID) {
+            QMessageBox::critical(this, tr("Error"), tr("TB %1 already exists in the database").arg(tb->title()), QMessageBox::Ok);
+            delete tb;
+            return;
+        }
 
-            // Check that the TB doesn't exist yet
-            // Don't allow to add twice the same TB
-            if (tb->number() == CurrentTB->number()) {
-                QMessageBox::critical(this, tr("Error"), tr("TB %1 already exists in the database").arg(tb->title()), QMessageBox::Ok);
-                return;
-            }
+        // Check for newer TB
+        // Don't allow to add an old TB
+        qint32 NewerId = this->Index->findTB(tb->replacedBy());
+        if (NewerId != INVALID_TB_ID) {
+            QMessageBox::critical(this, tr("Error"), tr("A new version of TB %1 already exists in the database").arg(this->Index->tb(NewerId)->title()), QMessageBox::Ok);
+            delete tb;
+            return;
+        }
 
-            // Check for newer TB
-            // Don't allow to add an old TB
-            QString ReplacedBy = tb->replacedBy();
-            if ((!ReplacedBy.isNull()) && (ReplacedBy == CurrentTB->number())) {
-                QMessageBox::critical(this, tr("Error"), tr("A new version of TB %1 already exists in the database").arg(CurrentTB->title()), QMessageBox::Ok);
+        // Check for older TB
+        // Don't allow to keep old TB
+        // Offer to merge keywords
+        qint32 OlderId = this->Index->findTB(tb->replaces());
+        if (OlderId != INVALID_TB_ID) {
+            TechnicalBulletin* OlderTB    = this->Index->tb(OlderId);
+            QMessageBox*       MessageBox = new QMessageBox(QMessageBox::Question,
+                                                      tr("Replace previous TB"),
+                                                      tr("An older version of TB %1 is present. Do you want to update it?").arg(OlderTB->title()));
+            MessageBox->addButton(tr("Update old TB"), QMessageBox::AcceptRole);
+            QPushButton* ButtonMerge  = MessageBox->addButton(tr("Update old TB and merge keywords"), QMessageBox::YesRole);
+            QPushButton* ButtonCancel = MessageBox->addButton(tr("Cancel"), QMessageBox::RejectRole);
+            MessageBox->setDefaultButton(ButtonMerge);
+
+            MessageBox->exec();
+            QAbstractButton* ClickedButton = MessageBox->clickedButton();
+            delete MessageBox;
+
+            // Nothing to do if the user cancelled the dialog
+            if (ClickedButton == ButtonCancel) {
+                delete tb;
                 return;
             }
 
-            // Check for older TB
-            // Don't allow to keep old TB
-            // Offer to merge keywords
-            if (tb->replaces() == CurrentTB->number()) {
-                QMessageBox* MessageBox = new QMessageBox(QMessageBox::Question,
-                                                          tr("Replace previous TB"),
-                                                          tr("An older version of TB %1 is present. Do you want to update it?").arg(CurrentTB->title()));
-                MessageBox->addButton(tr("Update old TB"), QMessageBox::AcceptRole);
-                QPushButton* ButtonMerge  = MessageBox->addButton(tr("Update old TB and merge keywords"), QMessageBox::YesRole);
-                QPushButton* ButtonCancel = MessageBox->addButton(tr("Cancel"), QMessageBox::RejectRole);
-                MessageBox->setDefaultButton(ButtonMerge);
-
-                MessageBox->exec();
-                QAbstractButton* ClickedButton = MessageBox->clickedButton();
-                delete MessageBox;
-
-                // Nothing to do if the user cancelled the dialog
-                if (ClickedButton == ButtonCancel) {
-                    return;
-                }
-
-                // Merge keywords
-                if (ClickedButton == ButtonMerge) {
-                    QList<QString> NewKeywords = tb->keywords();
-                    QList<QString> OldKeywords = CurrentTB->keywords();
-                    for (int j = 0; j < OldKeywords.count(); j++) {
-                        if (!NewKeywords.contains(OldKeywords.at(j))) {
-                            NewKeywords << OldKeywords.at(j);
-                        }
+            // Merge keywords
+            if (ClickedButton == ButtonMerge) {
+                QList<QString> NewKeywords = tb->keywords();
+                QList<QString> OldKeywords = OlderTB->keywords();
+                for (int j = 0; j < OldKeywords.count(); j++) {
+                    if (!NewKeywords.contains(OldKeywords.at(j))) {
+                        NewKeywords << OldKeywords.at(j);
                     }
-                    tb->setKeywords(NewKeywords);
                 }
-
-                // Delete old TB
-                delete CurrentTB;
-                ui->TableTB->removeRow(i);
-
-                // Finally, quit the loop to add the new TB
-                this->Modified = true;
-                break;
+                tb->setKeywords(NewKeywords);
             }
+
+            // Delete old TB
+            this->Model->removeTB(OlderId);
         }
     }
 
-    // We need to be sure that sorting is disabled, to add the TB at the end of the table.
-    // Else we will dereference a null pointer.
-    ui->TableTB->setSortingEnabled(false);
+    // Display the new TB at the bottom of the table, set it as the current one and display it
+    selectTB(this->Model->addTB(tb));
+}
 
-    // Update table size
-    int RowCount = ui->TableTB->rowCount();
-    ui->TableTB->setRowCount(RowCount + 1);
+//  currentTB
+//
+// Return the id of the selected TB, or INVALID_TB_ID
+//
+qint32 MainWindow::currentTB() const
+{
+    return ui->TableTB->selectionModel()->hasSelection() ? this->Model->tbId(ui->TableTB->currentIndex().row()) : INVALID_TB_ID;
+}
 
-    // Populate the new line with empty items
-    for (int i = 0; i < ui->TableTB->columnCount(); i++) {
-        ui->TableTB->setItem(RowCount, i, new QTableWidgetItem);
+//  selectTB
+//
+// Set a TB as the current one and make it visible
+//
+void MainWindow::selectTB(qint32 id)
+{
+    QModelIndex Cell = this->Model->index(this->Model->rowOfTB(id), COLUMN_NUMBER);
+    if (Cell.isValid()) {
+        ui->TableTB->setCurrentIndex(Cell);
+        ui->TableTB->scrollTo(Cell);
     }
+}
 
-    // Save an item ptr to make the last entry become the current one
-    QTableWidgetItem* Item = ui->TableTB->item(RowCount, 0);
+//  jumpToTB
+//
+// Ask for a TB number, then select the TB in the table
+//
+void MainWindow::jumpToTB()
+{
+    if (!this->IndexOpened) {
+        return;
+    }
 
-    // Display new TB in the new line
-    updateTB(tb, RowCount);
+    bool    Ok;
+    QString Number = QInputDialog::getText(this, WINDOW_TITLE, tr("Technical Bulletin number:"), QLineEdit::Normal, QString(), &Ok);
+    if (!Ok || Number.trimmed().isEmpty()) {
+        return;
+    }
 
-    // Re-enable table sorting, set the TB as the current one and display it
-    ui->TableTB->setSortingEnabled(true);
-    ui->TableTB->setCurrentItem(Item);
-    ui->TableTB->scrollToItem(Item);
+    qint32 Id = this->Index->findTB(Number);
+    if (Id == INVALID_TB_ID) {
+        ui->StatusBar->showMessage(tr("Technical Bulletin %1 not found").arg(Number.trimmed()), JUMP_MESSAGE_TIMEOUT);
+        return;
+    }
+
+    // The TB may be filtered out by the current search
+    if (this->Model->rowOfTB(Id) == -1) {
+        ui->EditKeywords->clear();
+    }
+    selectTB(Id);
 }
-*/
-//  updateTB
+
+//  resolveObsoleteTB
 //
-// Update the displayed data of an existing TB
+// Remove all the TB replaced by a more recent version present in the index.
+// Their keywords are merged into the latest version, then the table is rebuilt
 //
-void MainWindow::updateTB(TechnicalBulletin* tb, int row)
+void MainWindow::resolveObsoleteTB()
 {
-    // Set text corresponding to each TB data
-    ui->TableTB->item(row, COLUMN_NUMBER)->setText(tb->number());
-    ui->TableTB->item(row, COLUMN_TITLE)->setText(tb->title());
-    ui->TableTB->item(row, COLUMN_CATEGORY)->setText(tb->category());
-    ui->TableTB->item(row, COLUMN_RK)->setText(tb->rk());
-    ui->TableTB->item(row, COLUMN_TECH_PUB)->setText(tb->techpub());
-    ui->TableTB->item(row, COLUMN_RELEASE_DATE)->setText(tb->releaseDate().toString("yyyy/MM/dd"));
-    ui->TableTB->item(row, COLUMN_REGISTERED_BY)->setText(tb->registeredBy());
-    ui->TableTB->item(row, COLUMN_REPLACES)->setText(tb->replaces());
-    ui->TableTB->item(row, COLUMN_REPLACED_BY)->setText(tb->replacedBy());
-    ui->TableTB->item(row, COLUMN_KEYWORDS)->setText(tb->keywordsString());
+    if (!this->IndexOpened) {
+        return;
+    }
+
+    int Count = this->Index->obsoleteTB().count();
+    if (Count == 0) {
+        ui->StatusBar->showMessage(tr("No obsolete Technical Bulletin found"), JUMP_MESSAGE_TIMEOUT);
+        return;
+    }
+
+    QMessageBox::StandardButton Answer
+        = QMessageBox::question(this, WINDOW_TITLE, tr("%1 Technical Bulletins are replaced by a more recent version. Remove them and merge their keywords?").arg(Count));
+    if (Answer == QMessageBox::Yes) {
+        Count = this->Index->resolveObsoleteTB();
+        addLogEntry(QString("%1 obsolete Technical Bulletins removed").arg(Count));
+        populateUI();
+        search(FORCE_SEARCH);
+        updateUI();
+    }
+}
 
-    // Save tb ptr in the corresponding column and update UI
-    ui->TableTB->item(row, COLUMN_METADATA)->setData(TB_ROLE, QVariant::fromValue(tb));
+//  settingsChanged
+//
+// Apply the new settings published when the settings dialog is accepted
+//
+void MainWindow::settingsChanged(const SettingsSnapshot& snapshot)
+{
+    this->Completer->setSearchFields(snapshot.searchFields());
+    ui->ButtonSearch->setVisible(!snapshot.RealTimeSearch);
+    if (this->IndexOpened) {
+        setInboxDirectory(snapshot.InboxDirectory);
+    }
+    search(FORCE_SEARCH);
 }
 
 //  dragEnterEvent
@@ -823,7 +987,7 @@ void MainWindow::updateTB(TechnicalBulletin* tb, int row)
 //
 void MainWindow::dragEnterEvent(QDragEnterEvent* event)
 {
-    if (event->mimeData()->hasFormat("text/plain")) {
+    if (event->mimeData()->hasFormat("text/plain") || event->mimeData()->hasUrls()) {
         event->acceptProposedAction();
     }
 }
@@ -832,57 +996,433 @@ void MainWindow::dragEnterEvent(QDragEnterEvent* event)
 //
 // Handle dropped data. It should be the content of a mail
 //
-/*
 void MainWindow::dropEvent(QDropEvent* event)
 {
+    if (!this->IndexOpened) {
+        return;
+    }
+
+    // Files and directories: bulk import of the mails they contain
+    QStringList Paths;
+    QList<QUrl> Urls = event->mimeData()->urls();
+    for (int i = 0; i < Urls.count(); i++) {
+        if (Urls.at(i).isLocalFile()) {
+            Paths << Urls.at(i).toLocalFile();
+        }
+    }
+    if ((Paths.count() == 1) && (Paths.first().endsWith(".csv", Qt::CaseInsensitive) || Paths.first().endsWith(JSON_LINES_EXTENSION, Qt::CaseInsensitive))) {
+        importRecords(Paths.first());
+        return;
+    }
+    if (!Paths.isEmpty()) {
+        importMails(Paths);
+        return;
+    }
+
     TechnicalBulletin* TB = DlgTB::newDlgTB(this, event->mimeData()->data("text/plain"));
     if (TB != nullptr) {
-        this->Modified = true;
         addTB(TB, PERFORM_ADD_CHECKS);
         updateUI();
     }
 }
-*/
+
 //  paste
 //
 // Accept TB copy/pasted from mails
 //
-/*
 void MainWindow::paste()
 {
+    if (!this->IndexOpened) {
+        return;
+    }
+
     const QClipboard* Clipboard = QApplication::clipboard();
     if (Clipboard->mimeData()->hasFormat("text/plain")) {
         TechnicalBulletin* TB = DlgTB::newDlgTB(this, Clipboard->mimeData()->data("text/plain"));
         if (TB != nullptr) {
-            this->Modified = true;
             addTB(TB, PERFORM_ADD_CHECKS);
             updateUI();
         }
     }
 }
-*/
+
+//  importMails
+//
+// Import the TB of mails saved on disk: .eml or mbox files, or directories containing them.
+// The mails are parsed in a worker thread, with a progress dialog allowing to cancel the import
+//
+void MainWindow::importMails(const QStringList& paths)
+{
+    if (!this->IndexOpened || paths.isEmpty() || (this->ImportWatcher != nullptr)) {
+        return;
+    }
+
+    startLogTimer();
+    addLogEntry(QString("Importing mails from %1 file(s) or folder(s)...").arg(paths.count()));
+
+    QProgressDialog* Progress = new QProgressDialog(tr("Importing mails..."), tr("Cancel"), 0, 0, this);
+    Progress->setWindowModality(Qt::WindowModal);
+    Progress->setMinimumDuration(IMPORT_PROGRESS_DELAY);
+
+    this->ImportWatcher = new QFutureWatcher<QList<TechnicalBulletin*>>(this);
+    connect(this->ImportWatcher, &QFutureWatcherBase::progressRangeChanged, Progress, &QProgressDialog::setRange);
+    connect(this->ImportWatcher, &QFutureWatcherBase::progressValueChanged, Progress, &QProgressDialog::setValue);
+    connect(Progress, &QProgressDialog::canceled, this->ImportWatcher, &QFutureWatcherBase::cancel);
+    connect(this->ImportWatcher, &QFutureWatcherBase::finished, this, [this, Progress]() {
+        Progress->deleteLater();
+        importMailsFinished();
+    });
+    this->ImportWatcher->setFuture(QtConcurrent::run(&MailImporter::import, paths));
+}
+
+//  importMailsFinished
+//
+// Check the imported TB, then add them to the index at once.
+// The checks are the ones performed when a single TB is added, without asking anything:
+// the TB already present and the ones replaced by a TB of the index are ignored
+//
+void MainWindow::importMailsFinished()
+{
+    QFuture<QList<TechnicalBulletin*>> Future = this->ImportWatcher->future();
+    this->ImportWatcher->deleteLater();
+    this->ImportWatcher = nullptr;
+
+    // The result may have been reported just before the cancellation
+    if (Future.resultCount() == 0) {
+        addLogEntry("Mail import cancelled");
+        return;
+    }
+    QList<TechnicalBulletin*> Bulletins = Future.resultAt(0);
+    if (Future.isCanceled()) {
+        qDeleteAll(Bulletins);
+        addLogEntry("Mail import cancelled");
+        return;
+    }
+
+    // A TB number must be unique in the index and in the imported mails
+    QList<TechnicalBulletin*> Accepted;
+    QSet<QString>             Numbers;
+    int                       Invalid    = 0;
+    int                       Duplicates = 0;
+    int                       Obsolete   = 0;
+    for (int i = 0; i < Bulletins.count(); i++) {
+        TechnicalBulletin* TB     = Bulletins.at(i);
+        QString            Number = ThreadIndex::normalizeNumber(TB->number());
+        if (Number.isEmpty()) {
+            Invalid++;
+        }
+        else if ((this->Index->findTB(Number) != INVALID_TB_ID) || Numbers.contains(Number)) {
+            Duplicates++;
+        }
+        else if (this->Index->findTB(TB->replacedBy()) != INVALID_TB_ID) {
+            Obsolete++;
+        }
+        else {
+            Numbers.insert(Number);
+            Accepted << TB;
+            continue;
+        }
+        delete TB;
+    }
+
+    this->Model->addTBs(Accepted);
+    search(FORCE_SEARCH);
+    updateUI();
+
+    addLogEntry(QString("Mail import complete: %1 Technical Bulletins added, %2 already present, %3 replaced by a TB of the index, %4 mails without TB number")
+                    .arg(Accepted.count())
+                    .arg(Duplicates)
+                    .arg(Obsolete)
+                    .arg(Invalid));
+    addLogTimer();
+
+    // Only the chains of the imported TB can have changed
+    bool HasObsolete = false;
+    for (int i = 0; (i < Accepted.count()) && !HasObsolete; i++) {
+        HasObsolete = this->Index->hasObsoleteVersion(Accepted.at(i)->number());
+    }
+
+    QString Message = tr("%1 Technical Bulletins imported.").arg(Accepted.count());
+    if (HasObsolete) {
+        Message += tr("\nSome Technical Bulletins are replaced by a more recent version, press Ctrl-U to remove them.");
+    }
+    QMessageBox::information(this, WINDOW_TITLE, Message);
+}
+
+//  importRecords
+//
+// Import the TB of a CSV or JSON Lines file. The file is read in a worker thread,
+// the TB being added to the index by batches as soon as they are read
+//
+void MainWindow::importRecords(const QString& path)
+{
+    if (!this->IndexOpened || path.isEmpty() || (this->RecordWatcher != nullptr)) {
+        return;
+    }
+
+    startLogTimer();
+    addLogEntry(QString("Importing records from %1...").arg(QDir::toNativeSeparators(path)));
+
+    this->RecordBatches     = 0;
+    this->RecordsAdded      = 0;
+    this->RecordsDuplicated = 0;
+    this->RecordsRejected   = 0;
+
+    QProgressDialog* Progress = new QProgressDialog(tr("Importing records..."), tr("Cancel"), 0, 0, this);
+    Progress->setWindowModality(Qt::WindowModal);
+    Progress->setMinimumDuration(IMPORT_PROGRESS_DELAY);
+
+    this->RecordWatcher = new QFutureWatcher<ImportBatch>(this);
+    connect(this->RecordWatcher, &QFutureWatcherBase::progressRangeChanged, Progress, &QProgressDialog::setRange);
+    connect(this->RecordWatcher, &QFutureWatcherBase::progressValueChanged, Progress, &QProgressDialog::setValue);
+    connect(Progress, &QProgressDialog::canceled, this->RecordWatcher, &QFutureWatcherBase::cancel);
+    connect(this->RecordWatcher, &QFutureWatcherBase::resultsReadyAt, this, [this]() {
+        commitRecordBatches();
+        updateUI();
+    });
+    connect(this->RecordWatcher, &QFutureWatcherBase::finished, this, [this, Progress]() {
+        Progress->deleteLater();
+        commitRecordBatches();
+        bool Cancelled = this->RecordWatcher->isCanceled();
+        this->RecordWatcher->deleteLater();
+        this->RecordWatcher = nullptr;
+
+        search(FORCE_SEARCH);
+        updateUI();
+        addLogEntry(QString("Record import %1: %2 Technical Bulletins added, %3 already present, %4 records rejected")
+                        .arg(Cancelled ? "cancelled" : "complete")
+                        .arg(this->RecordsAdded)
+                        .arg(this->RecordsDuplicated)
+                        .arg(this->RecordsRejected));
+        addLogTimer();
+    });
+    this->RecordWatcher->setFuture(QtConcurrent::run(&RecordImporter::import, path));
+}
+
+//  commitRecordBatches
+//
+// Add the batches received since the last call to the index, one batch at once.
+// The TB already present in the index are dropped. If the import was cancelled, the pending batches are dropped
+//
+void MainWindow::commitRecordBatches()
+{
+    QFuture<ImportBatch> Future    = this->RecordWatcher->future();
+    bool                 Cancelled = Future.isCanceled();
+
+    for (; this->RecordBatches < Future.resultCount(); this->RecordBatches++) {
+        ImportBatch Batch = Future.resultAt(this->RecordBatches);
+        for (int i = 0; i < Batch.Errors.count(); i++) {
+            addLogEntry(Batch.Errors.at(i));
+        }
+        this->RecordsRejected += Batch.Rejected;
+
+        QList<TechnicalBulletin*> Accepted;
+        for (int i = 0; i < Batch.Bulletins.count(); i++) {
+            TechnicalBulletin* TB = Batch.Bulletins.at(i);
+            if (Cancelled) {
+                delete TB;
+            }
+            else if (this->Index->findTB(TB->number()) != INVALID_TB_ID) {
+                this->RecordsDuplicated++;
+                delete TB;
+            }
+            else {
+                Accepted << TB;
+            }
+        }
+
+        this->Model->addTBs(Accepted);
+        this->RecordsAdded += Accepted.count();
+    }
+}
+
+//  exportTB
+//
+// Export the TB to a CSV or JSON Lines file, in a worker thread. If a search is active,
+// the user chooses between the TB of the search result and the whole index. The TB are written in index order
+//
+void MainWindow::exportTB()
+{
+    if (!this->IndexOpened || (this->ExportWatcher != nullptr)) {
+        return;
+    }
+
+    // File and format
+    QString Csv       = tr("CSV (*.csv)");
+    QString JsonLines = tr("JSON Lines (*.jsonl)");
+    QString Filter;
+    QString Path = QFileDialog::getSaveFileName(this, tr("Export"), QString(), QString("%1;;%2").arg(Csv, JsonLines), &Filter);
+    if (Path.isEmpty()) {
+        return;
+    }
+    EXPORT_FORMAT Format = Filter == JsonLines ? EXPORT_JSON_LINES : EXPORT_CSV;
+
+    // TB to export
+    bool SearchResult = false;
+    if (!this->CurrentQuery.isEmpty()) {
+        QMessageBox* MessageBox   = new QMessageBox(QMessageBox::Question, tr("Export"), tr("Which Technical Bulletins do you want to export?"));
+        QPushButton* ButtonResult = MessageBox->addButton(tr("Search result (%1)").arg(this->Model->rowCount()), QMessageBox::AcceptRole);
+        MessageBox->addButton(tr("Whole index (%1)").arg(this->Model->tbCount()), QMessageBox::AcceptRole);
+        QPushButton* ButtonCancel = MessageBox->addButton(tr("Cancel"), QMessageBox::RejectRole);
+        MessageBox->setDefaultButton(ButtonResult);
+
+        MessageBox->exec();
+        QAbstractButton* ClickedButton = MessageBox->clickedButton();
+        delete MessageBox;
+
+        if (ClickedButton == ButtonCancel) {
+            return;
+        }
+        SearchResult = ClickedButton == ButtonResult;
+    }
+
+    // The worker reads a snapshot, so the index can be modified during the export
+    QSharedPointer<const IndexSnapshot> Snapshot  = this->Model->snapshot();
+    QBitArray                           Selection = SearchResult ? this->Model->filter() : QBitArray();
+    int                                 Count     = SearchResult ? this->Model->rowCount() : this->Model->tbCount();
+
+    startLogTimer();
+    addLogEntry(QString("Exporting %1 Technical Bulletins to %2...").arg(Count).arg(QDir::toNativeSeparators(Path)));
+
+    QProgressDialog* Progress = new QProgressDialog(tr("Exporting..."), tr("Cancel"), 0, 0, this);
+    Progress->setWindowModality(Qt::WindowModal);
+    Progress->setMinimumDuration(EXPORT_PROGRESS_DELAY);
+
+    this->ExportWatcher = new QFutureWatcher<bool>(this);
+    connect(this->ExportWatcher, &QFutureWatcherBase::progressRangeChanged, Progress, &QProgressDialog::setRange);
+    connect(this->ExportWatcher, &QFutureWatcherBase::progressValueChanged, Progress, &QProgressDialog::setValue);
+    connect(Progress, &QProgressDialog::canceled, this->ExportWatcher, &QFutureWatcherBase::cancel);
+    connect(this->ExportWatcher, &QFutureWatcherBase::finished, this, [this, Progress, Path]() {
+        Progress->deleteLater();
+        QFuture<bool> Future = this->ExportWatcher->future();
+        this->ExportWatcher->deleteLater();
+        this->ExportWatcher = nullptr;
+
+        if (Future.resultCount() == 0) {
+            addLogEntry("Export cancelled");
+        }
+        else if (Future.resultAt(0)) {
+            addLogEntry("Export complete");
+            addLogTimer();
+        }
+        else {
+            addLogEntry("Export failed");
+            QMessageBox::critical(this, tr("Export failed"), tr("Impossible to write the file %1").arg(QDir::toNativeSeparators(Path)));
+        }
+    });
+    this->ExportWatcher->setFuture(QtConcurrent::run(&TBExporter::exportTB, Snapshot, Selection, Path, Format));
+}
+
+//  setInboxDirectory
+//
+// Watch a new inbox directory, or disable the inbox if the directory is empty
+//
+void MainWindow::setInboxDirectory(const QString& directory)
+{
+    MailInbox* Inbox = this->Inbox;
+    QMetaObject::invokeMethod(this->Inbox, [Inbox, directory]() { Inbox->setDirectory(directory); }, Qt::QueuedConnection);
+}
+
+//  inboxMailsReceived
+//
+// New mails were found in the inbox. The TB which can be added without any question are added at once,
+// the mails of the TB already present or already replaced are archived.
+// The other ones (no number, release date not valid, replacing a TB of the index) are queued for a review.
+// The table is not searched again: the new rows are just inserted, and displayed even if they don't match the search
+//
+void MainWindow::inboxMailsReceived(const QList<InboxMail>& mails)
+{
+    QList<TechnicalBulletin*> Accepted;
+    QStringList               Handled;
+    QSet<QString>             Numbers;
+    int                       Ignored = 0;
+    int                       Review  = 0;
+
+    for (int i = 0; i < mails.count(); i++) {
+        InboxMail Mail = mails.at(i);
+        if (Mail.TB == nullptr) {
+            Ignored++;
+            continue;
+        }
+
+        QString Number = ThreadIndex::normalizeNumber(Mail.TB->number());
+        if (!Number.isEmpty()
+            && ((this->Index->findTB(Number) != INVALID_TB_ID) || Numbers.contains(Number) || (this->Index->findTB(Mail.TB->replacedBy()) != INVALID_TB_ID))) {
+            Handled << Mail.Path;
+            delete Mail.TB;
+        }
+        else if (Number.isEmpty() || !Mail.TB->releaseDate().isValid() || (this->Index->findTB(Mail.TB->replaces()) != INVALID_TB_ID)) {
+            delete Mail.TB;
+            Mail.TB = nullptr;
+            this->ReviewQueue << Mail;
+            Review++;
+        }
+        else {
+            Numbers.insert(Number);
+            Accepted << Mail.TB;
+            Handled << Mail.Path;
+        }
+    }
+
+    this->Model->addTBs(Accepted);
+    archiveInboxMails(Handled);
+    updateUI();
+
+    addLogEntry(QString("Inbox: %1 Technical Bulletins added, %2 mails to review, %3 already handled, %4 files without TB")
+                    .arg(Accepted.count())
+                    .arg(Review)
+                    .arg(Handled.count() - Accepted.count())
+                    .arg(Ignored));
+}
+
+//  archiveInboxMails
+//
+// Move the mail files handled out of the inbox
+//
+void MainWindow::archiveInboxMails(const QStringList& paths)
+{
+    if (paths.isEmpty()) {
+        return;
+    }
+
+    MailInbox* Inbox = this->Inbox;
+    QMetaObject::invokeMethod(this->Inbox, [Inbox, paths]() { Inbox->archive(paths); }, Qt::QueuedConnection);
+}
+
+//  reviewInbox
+//
+// Open the TB creation dialog for each mail waiting for a review, like if it was dropped in the window.
+// A mail is archived if its dialog is accepted. If it is cancelled, the file stays in the inbox,
+// and will be reviewed again at the next start
+//
+void MainWindow::reviewInbox()
+{
+    if (!this->IndexOpened) {
+        return;
+    }
+
+    while (!this->ReviewQueue.isEmpty()) {
+        InboxMail          Mail = this->ReviewQueue.takeFirst();
+        TechnicalBulletin* TB   = DlgTB::newDlgTB(this, Mail.Data);
+        if (TB != nullptr) {
+            addTB(TB, PERFORM_ADD_CHECKS);
+            archiveInboxMails(QStringList(Mail.Path));
+        }
+        updateUI();
+    }
+}
+
 //  tbNumberAlreadyExists
 //
 // Return true if an older TB exists in the database
 // Used by DlgTB to display a message saying that
 // there is already an older version of the TB in the index
 //
-//  TODO: to be moved to ThreadIndex engine
-//
-/*
 bool MainWindow::tbNumberAlreadyExists(TechnicalBulletin* tb)
 {
-    QString CurrentNumber = tb->replaces();
-    if (!CurrentNumber.isNull()) {
-        for (int i = 0; i < ui->TableTB->rowCount(); i++) {
-            if (CurrentNumber == ui->TableTB->item(i, COLUMN_METADATA)->data(TB_ROLE).value<TechnicalBulletin*>()->number()) {
-                return true;
-            }
-        }
-    }
-    return false;
+    return this->IndexOpened && (this->Index->findTB(tb->replaces()) != INVALID_TB_ID);
 }
-*/
+
 //  closeEvent
 //
 // Prevent the program from closing with modified data
@@ -918,9 +1458,10 @@ void MainWindow::closeEvent(QCloseEvent* event)
 //
 void MainWindow::copyURLToClipboard()
 {
-    QList<QTableWidgetItem*> Selection = ui->TableTB->selectedItems();
-    int                      Row       = Selection.at(0)->row();
-    TechnicalBulletin*       TB        = ui->TableTB->item(Row, COLUMN_METADATA)->data(TB_ROLE).value<TechnicalBulletin*>();
+    TechnicalBulletin* TB = this->Index->tb(currentTB());
+    if (TB == nullptr) {
+        return;
+    }
     QGuiApplication::clipboard()->setText(Settings::instance()->baseURLTechnicalBulletinWebpage().arg(TB->number()));
 }
 
@@ -930,9 +1471,10 @@ void MainWindow::copyURLToClipboard()
 //
 void MainWindow::openURL()
 {
-    QList<QTableWidgetItem*> Selection = ui->TableTB->selectedItems();
-    int                      Row       = Selection.at(0)->row();
-    TechnicalBulletin*       TB        = ui->TableTB->item(Row, COLUMN_METADATA)->data(TB_ROLE).value<TechnicalBulletin*>();
+    TechnicalBulletin* TB = this->Index->tb(currentTB());
+    if (TB == nullptr) {
+        return;
+    }
     QDesktopServices::openUrl(QString(Settings::instance()->baseURLTechnicalBulletinWebpage()).arg(TB->number()));
 }
 
@@ -22,18 +22,27 @@
 #ifndef MAINWINDOW_HPP
 #define MAINWINDOW_HPP
 
+#include "../Index/MailInbox.hpp"
+#include "../Index/RecordImporter.hpp"
 #include "../Index/TechnicalBulletin.hpp" // Probably to be removed after the data handling revamping?
 #include "../Index/ThreadIndex.hpp"
 #include "ContextMenuAction.hpp"
 #include "DownloadMenu.hpp"
+#include "HighlightDelegate.hpp"
+#include "KeywordCompleter.hpp"
+#include "TBTableModel.hpp"
+#include "Settings.hpp"
 #include <QByteArray>
 #include <QCloseEvent>
 #include <QDragEnterEvent>
 #include <QDropEvent>
+#include <QFutureWatcher>
 #include <QLabel>
 #include <QMainWindow>
 #include <QString>
 #include <QStringList>
+#include <QThread>
+#include <QTimer>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -50,24 +59,29 @@ class MainWindow: public QMainWindow
     Q_OBJECT
 
   public:
-    MainWindow(bool ForceIndexCheck);
+    MainWindow(bool ForceIndexCheck, bool MemoryReportOnOpening);
     ~MainWindow() override;
     bool tbNumberAlreadyExists(TechnicalBulletin* tb); // To be removed when DlgTB requests the Index directly
 
   private:
     Ui::MainWindow* ui;
     ThreadIndex*    Index;
+    TBTableModel*   Model;
     bool            SaveInProgress;
 
     // Status bar
     QLabel* MessageTBCount;
     QLabel* MessagePendingModifications;
+    QLabel* MessageInbox;
 
     // Context menu
     QMenu*             TableContextMenu;
     ContextMenuAction* ActionNewTB;
     ContextMenuAction* ActionEditTB;
     ContextMenuAction* ActionDeleteTB;
+    ContextMenuAction* ActionImportMails;
+    ContextMenuAction* ActionImportRecords;
+    ContextMenuAction* ActionExport;
     ContextMenuAction* ActionCopyUrl;
     ContextMenuAction* ActionOpenUrl;
     ContextMenuAction* ActionDownload;
@@ -77,19 +91,76 @@ class MainWindow: public QMainWindow
     // Download sub-menu
     DownloadMenu* DLMenu;
 
+    // Search field completion
+    KeywordCompleter* Completer;
+
+    // Highlighting of the matches in the table
+    HighlightDelegate* Highlighter;
+
+    // Settings changes
+    void settingsChanged(const SettingsSnapshot& snapshot);
+
+    // Search and edition are disabled until the index is opened
+    bool    IndexOpened;
+    bool    IndexOpeningFailed; // The index file exists but could not be opened
+    QString CurrentQuery;
+    void    indexReady();
+
+    // Real-time search debouncing
+    QTimer* SearchTimer;
+    double  SearchLatency; // ms
+    int     searchDelay() const;
+
+    // Progressive table population while the index is loading
+    bool    TBDisplayed;
+    QTimer* PopulateTimer;
+    void    tbAvailable(int count);
+    void    populateStep();
+    void    finishPopulating();
+
     // TBs
-    void populateUI();
-    void updateUI();
-    void newTB();
-    void editTB();
-    void deleteTB();
-    void search(bool ForceNewSearch = false);
-    void addTB(TechnicalBulletin* tb, bool PerformAddChecks = false);
-    void updateTB(TechnicalBulletin* tb, int row);
+    void   populateUI();
+    void   updateUI();
+    void   newTB();
+    void   editTB();
+    void   deleteTB();
+    void   search(bool ForceNewSearch = false);
+    void   addTB(TechnicalBulletin* tb, bool PerformAddChecks = false);
+    qint32 currentTB() const;
+    void   selectTB(qint32 id);
+    void   jumpToTB();
+    void   resolveObsoleteTB();
+
+    // Bulk import of mails saved on disk
+    QFutureWatcher<QList<TechnicalBulletin*>>* ImportWatcher;
+    void                                       importMails(const QStringList& paths);
+    void                                       importMailsFinished();
+
+    // Import of CSV or JSON Lines records, added to the index by batches while the file is read
+    QFutureWatcher<ImportBatch>* RecordWatcher;
+    int                          RecordBatches; // Batches already handled
+    int                          RecordsAdded;
+    int                          RecordsDuplicated;
+    int                          RecordsRejected;
+    void                         importRecords(const QString& path);
+    void                         commitRecordBatches();
+
+    // Export of the index or of the search result
+    QFutureWatcher<bool>* ExportWatcher;
+    void                  exportTB();
+
+    // Watched mail inbox. Mails which can't be added without the user are queued for review
+    QThread*         InboxThread;
+    MailInbox*       Inbox;
+    QList<InboxMail> ReviewQueue;
+    void             setInboxDirectory(const QString& directory);
+    void             inboxMailsReceived(const QList<InboxMail>& mails);
+    void             archiveInboxMails(const QStringList& paths);
+    void             reviewInbox();
 
     // Drag & drop stuff
     void dragEnterEvent(QDragEnterEvent* event) override;
-    //    void dropEvent(QDropEvent* event) override;
+    void dropEvent(QDropEvent* event) override;
 
     // Paste TB from mail to UI
     void paste();
@@ -113,6 +184,10 @@ class MainWindow: public QMainWindow
     bool  TBreadFirst;
     QTime LogTimer;
 
+    // Memory accounting, see MemoryReport
+    bool    MemoryReportOnOpening;
+    QString logMemoryReport();
+
     // Signals received from ThreadIndex
     void openingIndex(qint32 version, qint32 count);
     void tbRead(int count);
@@ -130,28 +205,30 @@ class MainWindow: public QMainWindow
     void save(bool backup);
 };
 
-// Table header index
-typedef enum {
-    COLUMN_NUMBER,
-    COLUMN_TITLE,
-    COLUMN_CATEGORY,
-    COLUMN_RK,
-    COLUMN_TECH_PUB,
-    COLUMN_RELEASE_DATE,
-    COLUMN_REGISTERED_BY,
-    COLUMN_REPLACES,
-    COLUMN_REPLACED_BY,
-    COLUMN_KEYWORDS
-} COLUMN_INDEX;
-
-// Role number of TB data ptr in TB table
-#define TB_ROLE         Qt::UserRole
-#define COLUMN_METADATA COLUMN_NUMBER
-
 // Search option
 #define FORCE_SEARCH true
 
 // Enable consistency and update checks when adding a TB
 #define PERFORM_ADD_CHECKS true
 
+// Real-time search: searches faster than this latency are immediate, slower ones are delayed
+// by the latency multiplied by the factor, up to the max delay (ms)
+#define SEARCH_INSTANT_LATENCY   8
+#define SEARCH_DELAY_FACTOR      2
+#define SEARCH_MAX_DELAY         250
+#define SEARCH_LATENCY_SMOOTHING 0.3
+
+// Progressive population: rows added at once, and max time spent per frame (ms)
+#define POPULATE_BATCH_SIZE   256
+#define POPULATE_FRAME_BUDGET 8
+
+// Delay before displaying the progress of a mail import (ms)
+#define IMPORT_PROGRESS_DELAY 500
+
+// Delay before displaying the progress of an export (ms)
+#define EXPORT_PROGRESS_DELAY 500
+
+// Duration of the status bar message when a TB number is not found (ms)
+#define JUMP_MESSAGE_TIMEOUT 3000
+
 #endif // MAINWINDOW_HPP
@@ -0,0 +1,219 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "TBSorter.hpp"
+#include "../Index/MemoryReport.hpp"
+#include <algorithm>
+
+TBSorter::TBSorter(ThreadIndex* index)
+    : Index(index)
+{
+    // Case insensitive, accents sorted by the locale rules, numbers compared by value (TB 9 < TB 10)
+    this->Collator.setCaseSensitivity(Qt::CaseInsensitive);
+    this->Collator.setNumericMode(true);
+    clear();
+}
+
+//  order
+//
+// Return the TB ids sorted by a column. The permutation is built on the first call
+//
+QList<qint32> TBSorter::order(int column, Qt::SortOrder order)
+{
+    if (!this->Columns[column].Built) {
+        build(column);
+    }
+
+    const QList<qint32>& Permutation = this->Columns[column].Permutation;
+    if (order == Qt::AscendingOrder) {
+        return Permutation;
+    }
+    return QList<qint32>(Permutation.crbegin(), Permutation.crend());
+}
+
+//  position
+//
+// Return the position of a TB in the order of a column
+//
+int TBSorter::position(int column, Qt::SortOrder order, qint32 id)
+{
+    if (!this->Columns[column].Built) {
+        build(column);
+    }
+
+    const Column& Col      = this->Columns[column];
+    auto          Position = std::lower_bound(Col.Permutation.begin(), Col.Permutation.end(), id, [this, &Col](qint32 a, qint32 b) { return lessThan(Col, a, b); });
+    int           Row      = static_cast<int>(Position - Col.Permutation.begin());
+    return order == Qt::AscendingOrder ? Row : static_cast<int>(Col.Permutation.count()) - 1 - Row;
+}
+
+//  clear
+//
+// Drop all the keys and permutations. Used when the index changes too much to be patched
+//
+void TBSorter::clear()
+{
+    for (int i = 0; i < COLUMN_COUNT; i++) {
+        this->Columns[i].Built = false;
+        this->Columns[i].Keys.clear();
+        this->Columns[i].Permutation.clear();
+    }
+}
+
+//  build
+//
+// Compute the keys of all the TB for a column, then sort them
+//
+void TBSorter::build(int column)
+{
+    Column&                   Col       = this->Columns[column];
+    QList<TechnicalBulletin*> Bulletins = this->Index->tbList();
+
+    Col.Keys.assign(Bulletins.count(), std::nullopt);
+    Col.Permutation.clear();
+    Col.Permutation.reserve(Bulletins.count());
+    for (int i = 0; i < Bulletins.count(); i++) {
+        if (Bulletins.at(i) != nullptr) {
+            Col.Keys[i] = sortKey(Bulletins.at(i), column);
+            Col.Permutation << i;
+        }
+    }
+
+    std::sort(Col.Permutation.begin(), Col.Permutation.end(), [this, &Col](qint32 a, qint32 b) { return lessThan(Col, a, b); });
+    Col.Built = true;
+}
+
+//  sortKey
+//
+// Return the collation key of a cell. Dates are compared in ISO format, whatever the displayed format is
+//
+QCollatorSortKey TBSorter::sortKey(const TechnicalBulletin* tb, int column) const
+{
+    if (column == COLUMN_RELEASE_DATE) {
+        return this->Collator.sortKey(tb->releaseDate().toString(Qt::ISODate));
+    }
+    return this->Collator.sortKey(TBTableModel::cellText(tb, column));
+}
+
+// Equal keys are ordered by id, so the order is total and the binary searches find an exact position
+//  precedes
+//
+// Return true if a TB is displayed before another one in a sorted column. The column must already be sorted
+//
+bool TBSorter::precedes(int column, Qt::SortOrder order, qint32 a, qint32 b) const
+{
+    return order == Qt::AscendingOrder ? lessThan(this->Columns[column], a, b) : lessThan(this->Columns[column], b, a);
+}
+
+bool TBSorter::lessThan(const Column& column, qint32 a, qint32 b) const
+{
+    int Result = column.Keys[a]->compare(*column.Keys[b]);
+    return (Result < 0) || ((Result == 0) && (a < b));
+}
+
+//  insert
+//
+// Compute the key of a TB, then insert it at its place in the permutation of a column
+//
+void TBSorter::insert(int column, qint32 id)
+{
+    Column& Col = this->Columns[column];
+    if (static_cast<size_t>(id) >= Col.Keys.size()) {
+        Col.Keys.resize(id + 1);
+    }
+    Col.Keys[id] = sortKey(this->Index->tb(id), column);
+
+    auto Position = std::lower_bound(Col.Permutation.begin(), Col.Permutation.end(), id, [this, &Col](qint32 a, qint32 b) { return lessThan(Col, a, b); });
+    Col.Permutation.insert(Position, id);
+}
+
+//  remove
+//
+// Remove a TB from the permutation of a column. Its key must be the one used to insert it
+//
+void TBSorter::remove(int column, qint32 id)
+{
+    Column& Col = this->Columns[column];
+    if ((static_cast<size_t>(id) >= Col.Keys.size()) || !Col.Keys[id].has_value()) {
+        return;
+    }
+
+    auto Position = std::lower_bound(Col.Permutation.begin(), Col.Permutation.end(), id, [this, &Col](qint32 a, qint32 b) { return lessThan(Col, a, b); });
+    if ((Position != Col.Permutation.end()) && (*Position == id)) {
+        Col.Permutation.erase(Position);
+    }
+    Col.Keys[id].reset();
+}
+
+//  tbAdded
+//
+// Insert a new TB in the built permutations
+//
+void TBSorter::tbAdded(qint32 id)
+{
+    for (int i = 0; i < COLUMN_COUNT; i++) {
+        if (this->Columns[i].Built) {
+            insert(i, id);
+        }
+    }
+}
+
+//  tbRemoved
+//
+// Remove a TB from the built permutations. Must be called before the TB is deleted
+//
+void TBSorter::tbRemoved(qint32 id)
+{
+    for (int i = 0; i < COLUMN_COUNT; i++) {
+        if (this->Columns[i].Built) {
+            remove(i, id);
+        }
+    }
+}
+
+//  tbAboutToBeUpdated / tbUpdated
+//
+// An edited TB is removed with its old keys, then inserted again with the new ones
+//
+void TBSorter::tbAboutToBeUpdated(qint32 id)
+{
+    tbRemoved(id);
+}
+
+void TBSorter::tbUpdated(qint32 id)
+{
+    tbAdded(id);
+}
+
+//  memoryUsage
+//
+// Estimate the memory used by the keys and the permutations.
+// The content of a collation key is private to QCollator, only its slot is counted
+//
+qint64 TBSorter::memoryUsage() const
+{
+    qint64 Bytes = 0;
+    for (int Column = 0; Column < COLUMN_COUNT; Column++) {
+        Bytes += static_cast<qint64>(this->Columns[Column].Keys.capacity() * sizeof(std::optional<QCollatorSortKey>));
+        Bytes += MemoryReport::arrayBytes(this->Columns[Column].Permutation.capacity(), sizeof(qint32));
+    }
+    return Bytes;
+}
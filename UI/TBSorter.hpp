@@ -0,0 +1,75 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef TBSORTER_HPP
+#define TBSORTER_HPP
+
+#include "../Index/ThreadIndex.hpp"
+#include "TBTableModel.hpp"
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QList>
+#include <optional>
+#include <vector>
+
+//  TBSorter
+//
+// Sort orders of the TB table.
+// For each column, a collation key is computed once per TB, so comparisons don't depend on the locale rules at sort time.
+// The sorted list of the TB ids (the permutation) of each column is computed on the first sort, then kept up to date:
+// when a TB is added, edited or removed, it is moved in the permutations using binary searches, without sorting again.
+// The descending order is the ascending permutation read backwards
+//
+class TBSorter
+{
+  public:
+    TBSorter(ThreadIndex* index);
+
+    QList<qint32> order(int column, Qt::SortOrder order);
+    int           position(int column, Qt::SortOrder order, qint32 id);
+    bool          precedes(int column, Qt::SortOrder order, qint32 a, qint32 b) const;
+    void          tbAdded(qint32 id);
+    void          tbRemoved(qint32 id);
+    void          tbAboutToBeUpdated(qint32 id);
+    void          tbUpdated(qint32 id);
+    void          clear();
+    qint64        memoryUsage() const;
+
+  private:
+    struct Column
+    {
+        bool                                         Built;
+        std::vector<std::optional<QCollatorSortKey>> Keys;        // By TB id
+        QList<qint32>                                Permutation; // TB ids, ascending order
+    };
+
+    ThreadIndex* Index;
+    QCollator    Collator;
+    Column       Columns[COLUMN_COUNT];
+
+    void             build(int column);
+    QCollatorSortKey sortKey(const TechnicalBulletin* tb, int column) const;
+    bool             lessThan(const Column& column, qint32 a, qint32 b) const;
+    void             insert(int column, qint32 id);
+    void             remove(int column, qint32 id);
+};
+
+#endif // TBSORTER_HPP
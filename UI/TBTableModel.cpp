@@ -0,0 +1,493 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#include "TBTableModel.hpp"
+#include "../Index/MemoryReport.hpp"
+#include "TBSorter.hpp"
+#include "Trace.hpp"
+#include <QBitArray>
+#include <QHash>
+#include <QString>
+#include <algorithm>
+#include <limits>
+
+TBTableModel::TBTableModel(ThreadIndex* index, QObject* parent)
+    : QAbstractTableModel(parent)
+    , Index(index)
+    , Loaded(0)
+    , Sorter(new TBSorter(index))
+    , SortColumn(-1)
+    , SortOrder(Qt::AscendingOrder)
+{
+}
+
+TBTableModel::~TBTableModel()
+{
+    delete this->Sorter;
+}
+
+int TBTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : this->Rows.count();
+}
+
+int TBTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+//  data
+//
+// Read a cell in the index
+//
+QVariant TBTableModel::data(const QModelIndex& index, int role) const
+{
+    const TechnicalBulletin* TB = tb(index.row());
+    if (!index.isValid() || (TB == nullptr)) {
+        return QVariant();
+    }
+
+    if (role == TB_ID_ROLE) {
+        return tbId(index.row());
+    }
+
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    return cellText(TB, index.column());
+}
+
+//  cellText
+//
+// Return the text displayed in a column for a TB
+//
+QString TBTableModel::cellText(const TechnicalBulletin* tb, int column)
+{
+    switch (column) {
+        case COLUMN_NUMBER:
+            return tb->number();
+        case COLUMN_TITLE:
+            return tb->title();
+        case COLUMN_CATEGORY:
+            return tb->category();
+        case COLUMN_RK:
+            return tb->rk();
+        case COLUMN_TECH_PUB:
+            return tb->techpub();
+        case COLUMN_RELEASE_DATE:
+            return tb->releaseDate().toString(TABLE_DATE_FORMAT);
+        case COLUMN_REGISTERED_BY:
+            return tb->registeredBy();
+        case COLUMN_REPLACES:
+            return tb->replaces();
+        case COLUMN_REPLACED_BY:
+            return tb->replacedBy();
+        case COLUMN_KEYWORDS:
+            return tb->keywordsString();
+        default:
+            return QString();
+    }
+}
+
+QVariant TBTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if ((orientation != Qt::Horizontal) || (role != Qt::DisplayRole)) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    switch (section) {
+        case COLUMN_NUMBER:
+            return tr("Number");
+        case COLUMN_TITLE:
+            return tr("Title");
+        case COLUMN_CATEGORY:
+            return tr("Category");
+        case COLUMN_RK:
+            return tr("RK number");
+        case COLUMN_TECH_PUB:
+            return tr("Tech. Publication");
+        case COLUMN_RELEASE_DATE:
+            return tr("Release date");
+        case COLUMN_REGISTERED_BY:
+            return tr("Registered by");
+        case COLUMN_REPLACES:
+            return tr("Replaces");
+        case COLUMN_REPLACED_BY:
+            return tr("Replaced by");
+        case COLUMN_KEYWORDS:
+            return tr("Keywords");
+        default:
+            return QVariant();
+    }
+}
+
+//  sort
+//
+// Sort the rows by a column. The sorted ids come from the sorter, only the id lists are replaced
+//
+void TBTableModel::sort(int column, Qt::SortOrder order)
+{
+    TRACE_SCOPE("Sort table");
+    if ((column < 0) || (column >= COLUMN_COUNT)) {
+        return;
+    }
+
+    // While the index is loading, the TB not displayed yet are displayed with the new order
+    qint32 Available = static_cast<qint32>(this->Index->tbList().count());
+    for (; this->Loaded < Available; this->Loaded++) {
+        this->Sorter->tbAdded(this->Loaded);
+    }
+
+    this->SortColumn = column;
+    this->SortOrder  = order;
+    this->Order      = this->Sorter->order(column, order);
+    updateRows();
+}
+
+//  setFilter
+//
+// Display only the TB whose bit is set. A null array displays all the TB.
+// The whole table is updated at once: the visible rows are computed, then the view is notified by a single layout change
+//
+void TBTableModel::setFilter(const QBitArray& filter)
+{
+    TRACE_SCOPE("Filter table");
+    this->Filter = filter;
+    updateRows();
+}
+
+//  updateRows
+//
+// Compute the visible rows from the display order and the filter,
+// keeping the selection and the current cell on the same TB
+//
+void TBTableModel::updateRows()
+{
+    emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+
+    QModelIndexList Persistent = persistentIndexList();
+    QList<qint32>   PersistentIds;
+    for (int i = 0; i < Persistent.count(); i++) {
+        PersistentIds << tbId(Persistent.at(i).row());
+    }
+
+    QHash<qint32, int> Positions;
+    this->Rows.clear();
+    this->Rows.reserve(this->Order.count());
+    for (int i = 0; i < this->Order.count(); i++) {
+        if (isVisible(this->Order.at(i))) {
+            Positions.insert(this->Order.at(i), static_cast<int>(this->Rows.count()));
+            this->Rows << this->Order.at(i);
+        }
+    }
+
+    // TB filtered out lose their persistent indexes
+    QModelIndexList Updated;
+    for (int i = 0; i < Persistent.count(); i++) {
+        int Row = Positions.value(PersistentIds.at(i), -1);
+        Updated << (Row != -1 ? index(Row, Persistent.at(i).column()) : QModelIndex());
+    }
+    changePersistentIndexList(Persistent, Updated);
+
+    emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
+
+//  lowerBound
+//
+// Return the position where a TB is, or would be inserted, in a list of ids in display order (Order or Rows).
+// Unsorted, the ids are increasing. Sorted, the sort keys are compared. Both are binary searches
+//
+int TBTableModel::lowerBound(const QList<qint32>& list, qint32 id) const
+{
+    QList<qint32>::const_iterator Position;
+    if (this->SortColumn == -1) {
+        Position = std::lower_bound(list.constBegin(), list.constEnd(), id);
+    }
+    else {
+        Position = std::lower_bound(list.constBegin(), list.constEnd(), id, [this](qint32 a, qint32 b) { return this->Sorter->precedes(this->SortColumn, this->SortOrder, a, b); });
+    }
+    return static_cast<int>(Position - list.constBegin());
+}
+
+//  indexOfTB
+//
+// Return the position of a TB in a list of ids in display order, or -1 if it is not in it
+//
+int TBTableModel::indexOfTB(const QList<qint32>& list, qint32 id) const
+{
+    int Position = lowerBound(list, id);
+    return (Position < list.count()) && (list.at(Position) == id) ? Position : -1;
+}
+
+//  reset
+//
+// Display all the TB of the index, in index order or in the current sort order. Removed TB are skipped
+//
+void TBTableModel::reset()
+{
+    beginResetModel();
+    this->Sorter->clear();
+    if (this->SortColumn != -1) {
+        this->Order = this->Sorter->order(this->SortColumn, this->SortOrder);
+    }
+    else {
+        QList<TechnicalBulletin*> Bulletins = this->Index->tbList();
+        this->Order.clear();
+        this->Order.reserve(Bulletins.count());
+        for (int i = 0; i < Bulletins.count(); i++) {
+            if (Bulletins.at(i) != nullptr) {
+                this->Order << i;
+            }
+        }
+    }
+    this->Loaded = static_cast<qint32>(this->Index->tbList().count());
+
+    this->Rows.clear();
+    for (int i = 0; i < this->Order.count(); i++) {
+        if (isVisible(this->Order.at(i))) {
+            this->Rows << this->Order.at(i);
+        }
+    }
+    endResetModel();
+}
+
+//  appendLoaded
+//
+// Display at most max TB appended to the index since the last call, while it is loading.
+// Return the number of TB still waiting to be displayed
+//
+int TBTableModel::appendLoaded(int max)
+{
+    TRACE_SCOPE("Append table rows");
+    qint32 Available = static_cast<qint32>(this->Index->tbList().count());
+    qint32 Last      = Available - this->Loaded > max ? this->Loaded + max : Available;
+    if (Last == this->Loaded) {
+        return 0;
+    }
+
+    // Unsorted and unfiltered table: the TB are appended
+    if ((this->SortColumn == -1) && this->Filter.isNull()) {
+        beginInsertRows(QModelIndex(), this->Rows.count(), this->Rows.count() + Last - this->Loaded - 1);
+        for (qint32 Id = this->Loaded; Id < Last; Id++) {
+            this->Order << Id;
+            this->Rows << Id;
+        }
+        this->Loaded = Last;
+        endInsertRows();
+    }
+
+    // Else the TB are inserted at their position, then the rows are updated at once.
+    // They are not filtered yet, the next search will do it
+    else {
+        for (; this->Loaded < Last; this->Loaded++) {
+            this->Sorter->tbAdded(this->Loaded);
+            int Position = this->SortColumn != -1 ? this->Sorter->position(this->SortColumn, this->SortOrder, this->Loaded) : this->Order.count();
+            this->Order.insert(Position, this->Loaded);
+            showTB(this->Loaded);
+        }
+        updateRows();
+    }
+
+    return Available - this->Loaded;
+}
+
+// Set the filter bit of a TB, if the table is filtered
+void TBTableModel::showTB(qint32 id)
+{
+    if (!this->Filter.isNull()) {
+        if (id >= this->Filter.size()) {
+            this->Filter.resize(id + 1);
+        }
+        this->Filter.setBit(id);
+    }
+}
+
+qint32 TBTableModel::tbId(int row) const
+{
+    return (row >= 0) && (row < this->Rows.count()) ? this->Rows.at(row) : INVALID_TB_ID;
+}
+
+TechnicalBulletin* TBTableModel::tb(int row) const
+{
+    return this->Index->tb(tbId(row));
+}
+
+//  rowOfTB
+//
+// Return the row displaying a TB, or -1 if the TB is not displayed
+//
+int TBTableModel::rowOfTB(qint32 id) const
+{
+    return indexOfTB(this->Rows, id);
+}
+
+//  addTB
+//
+// Add a TB to the index, and display it in a new row: at its sorted position, or at the bottom of the table.
+// A new TB is always displayed, even if it doesn't match the current filter
+//
+qint32 TBTableModel::addTB(TechnicalBulletin* tb)
+{
+    qint32 Id = this->Index->addTB(tb);
+    insertTBRow(Id);
+    return Id;
+}
+
+//  addTBs
+//
+// Add several TB to the index at once. They are visible even if they don't match the current search.
+// Each TB is inserted at its row, so the selection and the scroll position are kept. A large batch in a sorted table
+// would cost a row lookup per TB, so it is displayed like TB loaded with the index, with a single layout change
+//
+void TBTableModel::addTBs(const QList<TechnicalBulletin*>& bulletins)
+{
+    // TB of the index which are not displayed yet
+    appendLoaded(std::numeric_limits<int>::max());
+
+    qint32 First = static_cast<qint32>(this->Index->tbList().count());
+    this->Index->addTBs(bulletins);
+    qint32 Last = static_cast<qint32>(this->Index->tbList().count());
+
+    if ((this->SortColumn != -1) && (Last - First > TABLE_ROW_INSERTION_MAX)) {
+        appendLoaded(std::numeric_limits<int>::max());
+        return;
+    }
+
+    // Unsorted table: the TB are appended
+    if (this->SortColumn == -1) {
+        if (Last > First) {
+            beginInsertRows(QModelIndex(), this->Rows.count(), this->Rows.count() + Last - First - 1);
+            for (qint32 Id = First; Id < Last; Id++) {
+                this->Sorter->tbAdded(Id);
+                showTB(Id);
+                this->Order << Id;
+                this->Rows << Id;
+            }
+            this->Loaded = Last;
+            endInsertRows();
+        }
+        return;
+    }
+
+    for (qint32 Id = First; Id < Last; Id++) {
+        insertTBRow(Id);
+    }
+}
+
+//  insertTBRow
+//
+// Display a TB added to the index in a new row, at its sorted position or at the bottom of the table
+//
+void TBTableModel::insertTBRow(qint32 id)
+{
+    this->Sorter->tbAdded(id);
+    this->Loaded = id + 1;
+    showTB(id);
+
+    int Position = this->SortColumn != -1 ? this->Sorter->position(this->SortColumn, this->SortOrder, id) : this->Order.count();
+    int Row      = lowerBound(this->Rows, id);
+    beginInsertRows(QModelIndex(), Row, Row);
+    this->Order.insert(Position, id);
+    this->Rows.insert(Row, id);
+    endInsertRows();
+}
+
+//  updateTB
+//
+// Replace the data of a TB in the index, then refresh its row. The row is moved if the sorted column changed.
+// The TB is found with its old data, which give its current position
+//
+void TBTableModel::updateTB(qint32 id, const TechnicalBulletin& data)
+{
+    int Position = indexOfTB(this->Order, id);
+    int Row      = rowOfTB(id);
+
+    this->Sorter->tbAboutToBeUpdated(id);
+    this->Index->updateTB(id, data);
+    this->Sorter->tbUpdated(id);
+
+    if ((this->SortColumn != -1) && (Position != -1)) {
+        this->Order.move(Position, this->Sorter->position(this->SortColumn, this->SortOrder, id));
+
+        // The other rows are still sorted: the new row is searched before, then after the current one
+        if (Row != -1) {
+            auto Less   = [this](qint32 a, qint32 b) { return this->Sorter->precedes(this->SortColumn, this->SortOrder, a, b); };
+            auto Before = std::lower_bound(this->Rows.constBegin(), this->Rows.constBegin() + Row, id, Less);
+            int  NewRow = static_cast<int>(Before - this->Rows.constBegin());
+            if (NewRow == Row) {
+                NewRow = static_cast<int>(std::lower_bound(this->Rows.constBegin() + Row + 1, this->Rows.constEnd(), id, Less) - this->Rows.constBegin()) - 1;
+            }
+            if ((NewRow != Row) && beginMoveRows(QModelIndex(), Row, Row, QModelIndex(), NewRow > Row ? NewRow + 1 : NewRow)) {
+                this->Rows.move(Row, NewRow);
+                endMoveRows();
+            }
+            Row = NewRow;
+        }
+    }
+
+    if (Row != -1) {
+        emit dataChanged(index(Row, 0), index(Row, COLUMN_COUNT - 1));
+    }
+}
+
+//  removeTB
+//
+// Remove a TB from the index and from the table
+//
+void TBTableModel::removeTB(qint32 id)
+{
+    int Position = indexOfTB(this->Order, id);
+    int Row      = rowOfTB(id);
+    this->Sorter->tbRemoved(id);
+    if (Position != -1) {
+        this->Order.removeAt(Position);
+    }
+
+    if (Row != -1) {
+        beginRemoveRows(QModelIndex(), Row, Row);
+        this->Rows.removeAt(Row);
+        this->Index->removeTB(id);
+        endRemoveRows();
+    }
+    else {
+        this->Index->removeTB(id);
+    }
+}
+
+//  snapshot
+//
+// Return a read-only copy of the index. It is rebuilt only when the index was modified,
+// sharing the TB with the index
+//
+QSharedPointer<const IndexSnapshot> TBTableModel::snapshot()
+{
+    if (this->Snapshot.isNull() || (this->Snapshot->generation() != this->Index->generation())) {
+        this->Snapshot = QSharedPointer<const IndexSnapshot>(this->Index->snapshot());
+    }
+    return this->Snapshot;
+}
+
+qint64 TBTableModel::memoryUsage() const
+{
+    return MemoryReport::arrayBytes(this->Order.capacity(), sizeof(qint32)) + MemoryReport::arrayBytes(this->Rows.capacity(), sizeof(qint32))
+           + (this->Filter.size() + 7) / 8 + this->Sorter->memoryUsage();
+}
@@ -0,0 +1,132 @@
+/*
+ * TBI - Technical Bulletin Indexer - Save and index Technical Bulletins,
+ * allowing to use keywords to find them easily
+ * Copyright (C) 2020 Martial Demolins AKA Folco
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * mail: martial <dot> demolins <at> gmail <dot> com
+ */
+
+#ifndef TBTABLEMODEL_HPP
+#define TBTABLEMODEL_HPP
+
+#include "../Index/IndexSnapshot.hpp"
+#include "../Index/ThreadIndex.hpp"
+#include <QAbstractTableModel>
+#include <QBitArray>
+#include <QList>
+#include <QModelIndex>
+#include <QSharedPointer>
+#include <QString>
+#include <QVariant>
+
+class TBSorter;
+
+//  TBTableModel
+//
+// Model of the TB table. It doesn't copy anything: the cells are read from the index when the view asks for them.
+// The only data owned by the model are the lists of the TB ids: all of them in display order,
+// and the ones which are visible, ie. which match the current search.
+// The modifications of the index requested by the UI go through the model, so the views are notified.
+// When the table is sorted, new and edited TB are moved directly to their sorted position
+//
+class TBTableModel: public QAbstractTableModel
+{
+    Q_OBJECT
+
+  public:
+    TBTableModel(ThreadIndex* index, QObject* parent);
+    ~TBTableModel() override;
+
+    int      rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int      columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void     sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    static QString cellText(const TechnicalBulletin* tb, int column);
+
+    // Rows
+    void               reset();
+    int                appendLoaded(int max);
+    qint32             tbId(int row) const;
+    TechnicalBulletin* tb(int row) const;
+    int                rowOfTB(qint32 id) const;
+    int                tbCount() const { return static_cast<int>(this->Order.count()); }
+
+    // Search result. The filter has the bits of the visible TB, it is null if all the TB are visible
+    void             setFilter(const QBitArray& filter);
+    const QBitArray& filter() const { return this->Filter; }
+
+    // Read-only copy of the index, which can be read by a worker thread
+    QSharedPointer<const IndexSnapshot> snapshot();
+
+    // Memory used by the rows and the sort orders
+    qint64 memoryUsage() const;
+
+    // Index modifications
+    qint32 addTB(TechnicalBulletin* tb);
+    void   addTBs(const QList<TechnicalBulletin*>& bulletins);
+    void   updateTB(qint32 id, const TechnicalBulletin& data);
+    void   removeTB(qint32 id);
+
+  private:
+    ThreadIndex*  Index;
+    QList<qint32> Order;  // Id of all the TB, in display order
+    QList<qint32> Rows;   // Id of the visible TB, in display order
+    QBitArray     Filter; // Visible TB, all if null
+    qint32        Loaded; // Number of index slots already taken into account
+
+    // Last snapshot, rebuilt when the generation changed
+    QSharedPointer<const IndexSnapshot> Snapshot;
+
+    // Sort
+    TBSorter*     Sorter;
+    int           SortColumn; // -1 if the table is not sorted
+    Qt::SortOrder SortOrder;
+
+    void updateRows();
+    int  lowerBound(const QList<qint32>& list, qint32 id) const;
+    int  indexOfTB(const QList<qint32>& list, qint32 id) const;
+    void showTB(qint32 id);
+    void insertTBRow(qint32 id);
+    bool isVisible(qint32 id) const { return this->Filter.isNull() || ((id < this->Filter.size()) && this->Filter.testBit(id)); }
+};
+
+// Table header index
+typedef enum {
+    COLUMN_NUMBER,
+    COLUMN_TITLE,
+    COLUMN_CATEGORY,
+    COLUMN_RK,
+    COLUMN_TECH_PUB,
+    COLUMN_RELEASE_DATE,
+    COLUMN_REGISTERED_BY,
+    COLUMN_REPLACES,
+    COLUMN_REPLACED_BY,
+    COLUMN_KEYWORDS,
+    COLUMN_COUNT
+} COLUMN_INDEX;
+
+// Role returning the TB id of a row, in any column
+#define TB_ID_ROLE Qt::UserRole
+
+// Release date format in the table
+#define TABLE_DATE_FORMAT "yyyy/MM/dd"
+
+// Maximum number of TB added at once which are inserted row by row in a sorted table
+#define TABLE_ROW_INSERTION_MAX 256
+
+#endif // TBTABLEMODEL_HPP
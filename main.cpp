@@ -20,14 +20,57 @@
  */
 
 #include "Global.hpp"
+#include "Trace.hpp"
 #include "UI/MainWindow.hpp"
 #include <QApplication>
+#include <QThreadPool>
+#include <QTextStream>
+
+#ifdef Q_OS_WIN
+#include <cstdio>
+#include <windows.h>
+#endif
 
 int main(int argc, char* argv[])
 {
     QApplication Application(argc, argv);
-    bool         ForceIndexCheck = Application.arguments().contains(OPTION_FORCE_INDEX_CHECK);
-    MainWindow   Window(ForceIndexCheck);
-    Window.show();
-    return Application.exec();
+    bool         ForceIndexCheck       = Application.arguments().contains(OPTION_FORCE_INDEX_CHECK);
+    bool         MemoryReportOnOpening = Application.arguments().contains(OPTION_MEMORY_REPORT);
+
+    // --trace=<file>: record the time spent in the main steps, and write it on exit
+    QString TraceFile;
+    for (const QString& Argument : Application.arguments()) {
+        if (Argument.startsWith(OPTION_TRACE)) {
+            TraceFile = Argument.mid(QString(OPTION_TRACE).size());
+        }
+    }
+
+#ifdef Q_OS_WIN
+    // A Windows GUI program has no standard output: the reports are printed in the console which started it, if any.
+    // Else the memory report is still displayed in the log
+    if ((MemoryReportOnOpening || !TraceFile.isEmpty()) && AttachConsole(ATTACH_PARENT_PROCESS)) {
+        std::freopen("CONOUT$", "w", stdout);
+        std::freopen("CONOUT$", "w", stderr);
+    }
+#endif
+
+    if (!TraceFile.isEmpty()) {
+        Trace::enable();
+        Trace::setThreadName("GUI");
+    }
+
+    int Result;
+    {
+        MainWindow Window(ForceIndexCheck, MemoryReportOnOpening);
+        Window.show();
+        Result = Application.exec();
+    }
+
+    // The trace is written once no thread records events anymore: the window and its threads are destroyed,
+    // and the tasks of the pool are finished
+    QThreadPool::globalInstance()->waitForDone();
+    if (!TraceFile.isEmpty() && !Trace::write(TraceFile)) {
+        QTextStream(stderr) << QString("Impossible to write the trace in %1\n").arg(TraceFile);
+    }
+    return Result;
 }